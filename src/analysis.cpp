@@ -0,0 +1,727 @@
+/* Analysis of the position on the board, for live commentary
+ */
+
+#include <iostream>
+#include <algorithm>
+#include <sstream>
+#include <cstdio>
+#include <chrono>
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "analysis.h"
+
+using namespace std;
+
+#define TT_EXACT 0
+#define TT_LOWER 1 //the score is at least this
+#define TT_UPPER 2 //the score is at most this
+#define INFINITE_SCORE (MATE_SCORE + 1)
+#define STOP_CHECK_NODES 1024 //look at the stopflag once every so many nodes
+
+//value of every kind of piece (nr/2): pawn, king, queen, bishop, knight, rook
+static const int pieceValue[6] = {100, 0, 900, 330, 320, 500};
+
+//piece-square tables, seen from white with rank 8 on top (so as they look on a diagram)
+static const int pawnTable[64] = {
+     0,  0,  0,  0,  0,  0,  0,  0,
+    50, 50, 50, 50, 50, 50, 50, 50,
+    10, 10, 20, 30, 30, 20, 10, 10,
+     5,  5, 10, 25, 25, 10,  5,  5,
+     0,  0,  0, 20, 20,  0,  0,  0,
+     5, -5,-10,  0,  0,-10, -5,  5,
+     5, 10, 10,-20,-20, 10, 10,  5,
+     0,  0,  0,  0,  0,  0,  0,  0};
+static const int kingTable[64] = {
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -20,-30,-30,-40,-40,-30,-30,-20,
+   -10,-20,-20,-20,-20,-20,-20,-10,
+    20, 20,  0,  0,  0,  0, 20, 20,
+    20, 30, 10,  0,  0, 10, 30, 20};
+static const int queenTable[64] = {
+   -20,-10,-10, -5, -5,-10,-10,-20,
+   -10,  0,  0,  0,  0,  0,  0,-10,
+   -10,  0,  5,  5,  5,  5,  0,-10,
+    -5,  0,  5,  5,  5,  5,  0, -5,
+     0,  0,  5,  5,  5,  5,  0, -5,
+   -10,  5,  5,  5,  5,  5,  0,-10,
+   -10,  0,  5,  0,  0,  0,  0,-10,
+   -20,-10,-10, -5, -5,-10,-10,-20};
+static const int bishopTable[64] = {
+   -20,-10,-10,-10,-10,-10,-10,-20,
+   -10,  0,  0,  0,  0,  0,  0,-10,
+   -10,  0,  5, 10, 10,  5,  0,-10,
+   -10,  5,  5, 10, 10,  5,  5,-10,
+   -10,  0, 10, 10, 10, 10,  0,-10,
+   -10, 10, 10, 10, 10, 10, 10,-10,
+   -10,  5,  0,  0,  0,  0,  5,-10,
+   -20,-10,-10,-10,-10,-10,-10,-20};
+static const int knightTable[64] = {
+   -50,-40,-30,-30,-30,-30,-40,-50,
+   -40,-20,  0,  0,  0,  0,-20,-40,
+   -30,  0, 10, 15, 15, 10,  0,-30,
+   -30,  5, 15, 20, 20, 15,  5,-30,
+   -30,  0, 15, 20, 20, 15,  0,-30,
+   -30,  5, 10, 15, 15, 10,  5,-30,
+   -40,-20,  0,  5,  5,  0,-20,-40,
+   -50,-40,-30,-30,-30,-30,-40,-50};
+static const int rookTable[64] = {
+     0,  0,  0,  0,  0,  0,  0,  0,
+     5, 10, 10, 10, 10, 10, 10,  5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+     0,  0,  0,  5,  5,  0,  0,  0};
+static const int* const pieceTable[6] = {pawnTable, kingTable, queenTable, bishopTable, knightTable, rookTable};
+
+static bool isMateScore(int score)
+{
+    return score > MATE_SCORE - 1000 || score < -(MATE_SCORE - 1000);
+}
+
+/* Function that fills in the score of a result, from white's point of view
+ *  input: the result, the score from the side to move's point of view (a mate score counts the plies from the root), and the side to move
+ *  output: void
+ */
+static void setScore(analysisResult* result, int score, bool whitetomove)
+{
+    int sign = whitetomove ? 1 : -1;
+    result->score = sign*score;
+    result->mate = 0;
+    if (isMateScore(score))
+    {
+        int plies = MATE_SCORE - abs(score);
+        result->mate = sign*(score > 0 ? 1 : -1)*((plies + 1)/2);
+    }
+}
+
+/* Function that writes a score the way it's shown in commentary
+ *  input: the result
+ *  output: the score in pawns (eg "+0.35"), or "#n" if there's a mate in n moves ("#-n" if black mates)
+ */
+string scoreToString(const analysisResult& result)
+{
+    if (result.mate != 0)
+    {
+        return "#" + to_string(result.mate);
+    }
+    char text[16];
+    snprintf(text, sizeof(text), "%+.2f", result.score/100.0);
+    return text;
+}
+
+AlphaBetaEngine::AlphaBetaEngine(int maxdepth, int ttsizemb) : maxdepth(maxdepth), nodes(0), aborted(false)
+{
+    //the size of the table is a power of 2, so the index is just the low bits of the key
+    size_t entries = 1;
+    while (entries*2*sizeof(ttEntry) <= (size_t)ttsizemb*1024*1024)
+    {
+        entries *= 2;
+    }
+    ttEntry empty = {0, -1, TT_EXACT, 0, 0};
+    table.assign(entries, empty);
+}
+
+void AlphaBetaEngine::search(Board position, const atomic<bool>& stop, function<void(const analysisResult&)> report)
+{
+    nodes = 0;
+    aborted = false;
+
+    analysisResult result;
+    result.key = position.key();
+    result.ply = position.ply();
+    result.depth = 0;
+    result.final = false;
+
+    if (position.legalMoves().empty())
+    {//nothing to search: mate or stalemate
+        setScore(&result, position.inCheck() ? -MATE_SCORE : 0, position.whiteToMove());
+        result.final = true;
+        report(result);
+        return;
+    }
+
+    //iterative deepening: every depth fills the table with better moves to try first on the next one,
+    //and there's always a result from the last finished depth when the search gets cancelled
+    for (int depth = 1; depth <= maxdepth; depth++)
+    {
+        int score = negamax(position, depth, -INFINITE_SCORE, INFINITE_SCORE, 0, stop);
+        if (aborted)
+        {
+            return;
+        }
+        result.depth = depth;
+        setScore(&result, score, position.whiteToMove());
+        const ttEntry& entry = table[position.key() & (table.size() - 1)];
+        chessMove best = decodeMove(entry.move);
+        result.bestmove = entry.key == position.key() && position.isLegal(best) ? position.toSan(best) : "";
+        result.pv = principalVariation(position, depth);
+        result.final = depth == maxdepth || isMateScore(score); //no point in searching a mate deeper
+        report(result);
+        if (result.final)
+        {
+            return;
+        }
+    }
+}
+
+/* Function that searches a position with alpha-beta
+ *  input: the position, the depth left, the window, the distance to the root and the stopflag
+ *  output: the score from the side to move's point of view
+ */
+int AlphaBetaEngine::negamax(Board& b, int depth, int alpha, int beta, int ply, const atomic<bool>& stop)
+{
+    if (++nodes % STOP_CHECK_NODES == 0 && stop.load())
+    {
+        aborted = true;
+    }
+    if (aborted)
+    {
+        return 0;
+    }
+    if (ply > 0 && (b.repetitions() >= 2 || b.fiftyMoves()))
+    {//a repetition in the tree is as good as a draw
+        return 0;
+    }
+    if (depth <= 0)
+    {
+        return quiesce(b, alpha, beta, ply, stop);
+    }
+
+    ttEntry& entry = table[b.key() & (table.size() - 1)];
+    uint16_t ttmove = 0;
+    if (entry.key == b.key())
+    {
+        ttmove = entry.move;
+        if (entry.depth >= depth && ply > 0)
+        {
+            //mate scores are stored as the distance from this position, not from the root
+            int score = entry.score;
+            if (isMateScore(score))
+            {
+                score += score > 0 ? -ply : ply;
+            }
+            if (entry.bound == TT_EXACT || (entry.bound == TT_LOWER && score >= beta) || (entry.bound == TT_UPPER && score <= alpha))
+            {
+                return score;
+            }
+        }
+    }
+
+    vector<chessMove> moves = b.legalMoves();
+    if (moves.empty())
+    {
+        return b.inCheck() ? -MATE_SCORE + ply : 0;
+    }
+    orderMoves(b, &moves, ttmove);
+
+    int alphastart = alpha;
+    int best = -INFINITE_SCORE;
+    uint16_t bestmove = 0;
+    for (int i = 0; i < moves.size(); i++)
+    {
+        b.makeMove(moves[i]);
+        int score = -negamax(b, depth - 1, -beta, -alpha, ply + 1, stop);
+        b.unmakeMove();
+        if (aborted)
+        {
+            return 0;
+        }
+        if (score > best)
+        {
+            best = score;
+            bestmove = encodeMove(moves[i]);
+        }
+        if (score > alpha)
+        {
+            alpha = score;
+        }
+        if (alpha >= beta)
+        {
+            break;
+        }
+    }
+
+    ttEntry& store = table[b.key() & (table.size() - 1)]; //the children may have written over the entry
+    store.key = b.key();
+    store.depth = depth;
+    store.bound = best <= alphastart ? TT_UPPER : (best >= beta ? TT_LOWER : TT_EXACT);
+    store.move = bestmove;
+    store.score = isMateScore(best) ? best + (best > 0 ? ply : -ply) : best;
+    return best;
+}
+
+/* Function that only searches captures, so the evaluation isn't done in the middle of an exchange
+ *  input: the position, the window, the distance to the root and the stopflag
+ *  output: the score from the side to move's point of view
+ */
+int AlphaBetaEngine::quiesce(Board& b, int alpha, int beta, int ply, const atomic<bool>& stop)
+{
+    if (++nodes % STOP_CHECK_NODES == 0 && stop.load())
+    {
+        aborted = true;
+    }
+    if (aborted)
+    {
+        return 0;
+    }
+
+    int standpat = evaluate(b);
+    if (standpat >= beta)
+    {
+        return standpat;
+    }
+    if (standpat > alpha)
+    {
+        alpha = standpat;
+    }
+
+    vector<chessMove> moves = b.legalMoves();
+    vector<chessMove> captures;
+    for (int i = 0; i < moves.size(); i++)
+    {
+        if (b.at(moves[i].to) != NO_PIECE || moves[i].promotion != NO_PIECE)
+        {
+            captures.push_back(moves[i]);
+        }
+    }
+    orderMoves(b, &captures, 0);
+
+    for (int i = 0; i < captures.size(); i++)
+    {
+        b.makeMove(captures[i]);
+        int score = -quiesce(b, -beta, -alpha, ply + 1, stop);
+        b.unmakeMove();
+        if (aborted)
+        {
+            return 0;
+        }
+        if (score >= beta)
+        {
+            return score;
+        }
+        if (score > alpha)
+        {
+            alpha = score;
+        }
+    }
+    return alpha;
+}
+
+/* Function that evaluates a position: material and piece-square tables
+ *  input: the position
+ *  output: the score from the side to move's point of view
+ */
+int AlphaBetaEngine::evaluate(const Board& b) const
+{
+    int score = 0;
+    for (int square = 0; square < 64; square++)
+    {
+        int nr = b.at(square);
+        if (nr == NO_PIECE)
+        {
+            continue;
+        }
+        //the tables have rank 8 on top, for black they're mirrored
+        int index = isWhite(nr) ? squareOf(7 - rankOf(square), fileOf(square)) : square;
+        int value = pieceValue[nr/2] + pieceTable[nr/2][index];
+        score += isWhite(nr) ? value : -value;
+    }
+    return b.whiteToMove() ? score : -score;
+}
+
+/* Function that sorts the moves so the ones that are most likely the best come first
+ * the move from the transposition table, then captures (most valuable victim first, by the least valuable attacker), then the rest
+ *  input: the position, the moves and the move from the transposition table (0 if there is none)
+ *  output: void
+ */
+void AlphaBetaEngine::orderMoves(const Board& b, vector<chessMove>* moves, uint16_t ttmove) const
+{
+    vector<pair<int, int>> order; //(-priority, index), so sorting puts the highest priority first
+    for (int i = 0; i < moves->size(); i++)
+    {
+        const chessMove& m = (*moves)[i];
+        int priority = 0;
+        if (ttmove != 0 && encodeMove(m) == ttmove)
+        {
+            priority = 100000;
+        }
+        else if (b.at(m.to) != NO_PIECE)
+        {
+            priority = 10000 + 10*pieceValue[b.at(m.to)/2] - pieceValue[b.at(m.from)/2]/10;
+        }
+        else if (m.promotion != NO_PIECE)
+        {
+            priority = 9000 + pieceValue[m.promotion/2]/10;
+        }
+        order.push_back(make_pair(-priority, i));
+    }
+    sort(order.begin(), order.end());
+
+    vector<chessMove> sorted;
+    for (int i = 0; i < order.size(); i++)
+    {
+        sorted.push_back((*moves)[order[i].second]);
+    }
+    *moves = sorted;
+}
+
+/* Function that follows the best moves in the transposition table
+ *  input: the position and how many moves to follow at most
+ *  output: the moves in SAN, separated by spaces
+ */
+string AlphaBetaEngine::principalVariation(Board b, int depth)
+{
+    string pv;
+    for (int i = 0; i < depth; i++)
+    {
+        const ttEntry& entry = table[b.key() & (table.size() - 1)];
+        chessMove m = decodeMove(entry.move);
+        if (entry.key != b.key() || entry.move == 0 || !b.isLegal(m))
+        {
+            break;
+        }
+        pv += (pv.empty() ? "" : " ") + b.toSan(m);
+        b.makeMove(m);
+    }
+    return pv;
+}
+
+/* Function that starts an engine that speaks UCI
+ * a socketpair is used instead of two pipes, so writing to an engine that crashed gives an error instead of a SIGPIPE
+ *  input: the path of the engine, and how long it can think about every position (0 for as long as it wants)
+ */
+UciEngine::UciEngine(string path, int movetimems) : pid(-1), fd(-1), movetime(movetimems)
+{
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+    {
+        return;
+    }
+    pid = fork();
+    if (pid < 0)
+    {
+        ::close(sv[0]);
+        ::close(sv[1]);
+        return;
+    }
+    if (pid == 0)
+    {//the engine: its stdin and stdout are the other end of the socketpair
+        dup2(sv[1], STDIN_FILENO);
+        dup2(sv[1], STDOUT_FILENO);
+        ::close(sv[0]);
+        ::close(sv[1]);
+        execl(path.c_str(), path.c_str(), (char*)NULL);
+        _exit(127);
+    }
+    ::close(sv[1]);
+    fd = sv[0];
+
+    send("uci");
+    if (!waitFor("uciok", 5000))
+    {
+        cerr << path << " doesn't speak UCI" << endl;
+        ::close(fd);
+        fd = -1;
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        pid = -1;
+        return;
+    }
+    send("isready");
+    waitFor("readyok", 5000);
+}
+
+UciEngine::~UciEngine()
+{
+    if (fd >= 0)
+    {
+        send("quit");
+        ::close(fd);
+    }
+    if (pid > 0)
+    {
+        //give it a moment to quit by itself
+        for (int i = 0; i < 50; i++)
+        {
+            if (waitpid(pid, NULL, WNOHANG) == pid)
+            {
+                return;
+            }
+            usleep(10000);
+        }
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+}
+
+void UciEngine::send(string line)
+{
+    line += "\n";
+    if (fd >= 0)
+    {
+        ::send(fd, line.c_str(), line.size(), MSG_NOSIGNAL);
+    }
+}
+
+/* Function that reads a line from the engine
+ *  input: a pointer to the line, and how long to wait for it
+ *  output: true if there was a line, false if there wasn't one in time (or the engine quit, then fd becomes -1)
+ */
+bool UciEngine::receive(string* line, int timeoutms)
+{
+    while (true)
+    {
+        size_t newline = buffer.find('\n');
+        if (newline != string::npos)
+        {
+            *line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (!line->empty() && (*line)[line->size() - 1] == '\r')
+            {
+                line->erase(line->size() - 1);
+            }
+            return true;
+        }
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        pollfd p = {fd, POLLIN, 0};
+        if (poll(&p, 1, timeoutms) <= 0)
+        {
+            return false;
+        }
+        char data[4096];
+        ssize_t n = read(fd, data, sizeof(data));
+        if (n <= 0)
+        {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        buffer.append(data, n);
+    }
+}
+
+bool UciEngine::waitFor(string expected, int timeoutms)
+{
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutms);
+    string line;
+    while (chrono::steady_clock::now() < deadline && fd >= 0)
+    {
+        if (receive(&line, 50) && line.compare(0, expected.size(), expected) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Function that turns a move in UCI notation (eg e2e4 or e7e8q) into a move on the board
+ *  input: the position and the move
+ *  output: true if the move is legal, and the move itself
+ */
+static bool parseUciMove(Board& b, string uci, chessMove* m)
+{
+    if (uci.size() < 4)
+    {
+        return false;
+    }
+    m->from = squareOf(uci[1] - '1', uci[0] - 'a');
+    m->to = squareOf(uci[3] - '1', uci[2] - 'a');
+    m->promotion = NO_PIECE;
+    if (uci.size() > 4)
+    {
+        int white = b.whiteToMove() ? 1 : 0;
+        switch (uci[4])
+        {
+            case 'q': m->promotion = QUEEN_B + white; break;
+            case 'r': m->promotion = ROOK_B + white; break;
+            case 'b': m->promotion = BISH_B + white; break;
+            case 'n': m->promotion = KNIGHT_B + white; break;
+        }
+    }
+    if (m->from < 0 || m->from > 63 || m->to < 0 || m->to > 63)
+    {
+        return false;
+    }
+    return b.isLegal(*m);
+}
+
+void UciEngine::search(Board position, const atomic<bool>& stop, function<void(const analysisResult&)> report)
+{
+    if (fd < 0)
+    {
+        return;
+    }
+    analysisResult result;
+    result.key = position.key();
+    result.ply = position.ply();
+    result.depth = 0;
+    result.score = 0;
+    result.mate = 0;
+    result.final = false;
+    bool hasresult = false;
+
+    send("position fen " + position.toFen());
+    send(movetime > 0 ? "go movetime " + to_string(movetime) : "go infinite");
+
+    bool stopsent = false;
+    string line;
+    while (fd >= 0)
+    {
+        if (stop.load() && !stopsent)
+        {
+            send("stop");
+            stopsent = true;
+        }
+        if (!receive(&line, 20))
+        {
+            continue;
+        }
+
+        istringstream words(line);
+        string word;
+        words >> word;
+        if (word == "bestmove")
+        {
+            //a stopped search still answers with a bestmove, but the position is already old by then
+            if (hasresult && !stopsent)
+            {
+                result.final = true;
+                report(result);
+            }
+            return;
+        }
+        if (word != "info" || line.find(" pv ") == string::npos || line.find("bound") != string::npos)
+        {
+            continue;
+        }
+
+        //info depth 12 seldepth 18 score cp 34 nodes 1234 pv e2e4 e7e5 ...
+        while (words >> word)
+        {
+            if (word == "depth")
+            {
+                words >> result.depth;
+            }
+            else if (word == "score")
+            {
+                string kind;
+                int value;
+                words >> kind >> value;
+                int sign = position.whiteToMove() ? 1 : -1; //uci scores are from the side to move's point of view
+                result.score = kind == "mate" ? sign*(value > 0 ? MATE_SCORE - 2*value + 1 : -MATE_SCORE - 2*value) : sign*value;
+                result.mate = kind == "mate" ? sign*value : 0;
+            }
+            else if (word == "pv")
+            {
+                Board continuation = position;
+                result.pv.clear();
+                result.bestmove.clear();
+                chessMove m;
+                while (words >> word && parseUciMove(continuation, word, &m))
+                {
+                    string san = continuation.toSan(m);
+                    if (result.bestmove.empty())
+                    {
+                        result.bestmove = san;
+                    }
+                    result.pv += (result.pv.empty() ? "" : " ") + san;
+                    continuation.makeMove(m);
+                }
+            }
+        }
+        hasresult = true;
+        report(result);
+    }
+}
+
+Analyzer::Analyzer(unique_ptr<AnalysisEngine> engine) : engine(move(engine)), haspending(false), quit(false), stop(false), hasresult(false), fresh(false)
+{
+    worker = thread(&Analyzer::run, this);
+}
+
+Analyzer::~Analyzer()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        quit = true;
+        stop.store(true);
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void Analyzer::analyse(const Board& position)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        pending = position;
+        haspending = true;
+        stop.store(true); //cancel whatever is being searched now
+    }
+    wake.notify_all();
+}
+
+bool Analyzer::poll(analysisResult* r)
+{
+    lock_guard<mutex> guard(lock);
+    if (!fresh)
+    {
+        return false;
+    }
+    *r = result;
+    fresh = false;
+    return true;
+}
+
+bool Analyzer::latest(analysisResult* r) const
+{
+    lock_guard<mutex> guard(lock);
+    if (hasresult)
+    {
+        *r = result;
+    }
+    return hasresult;
+}
+
+//the thread of the analyzer: waits for a position, searches it, and repeats
+void Analyzer::run()
+{
+    while (true)
+    {
+        Board position;
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [this] { return haspending || quit; });
+            if (quit)
+            {
+                return;
+            }
+            position = pending;
+            haspending = false;
+            stop.store(false);
+        }
+
+        engine->search(position, stop, [this](const analysisResult& r)
+        {
+            lock_guard<mutex> guard(lock);
+            if (!haspending) //a result for a position that's already gone isn't worth anything
+            {
+                result = r;
+                hasresult = true;
+                fresh = true;
+            }
+        });
+    }
+}
@@ -0,0 +1,119 @@
+/* Analysis of the position on the board, for live commentary
+ * the analyzer runs on its own thread: analyse() only hands over the position and returns,
+ * a search that's still running gets cancelled as soon as the next position comes in.
+ */
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include "board.h"
+
+#define MATE_SCORE 100000 //a score above MATE_SCORE - 1000 is a mate
+
+struct analysisResult
+{
+    uint64_t key;       //zobrist key of the position that was analysed
+    int ply;            //ply of the game the position is on
+    int depth;          //depth the search finished
+    int score;          //centipawns, from white's point of view
+    int mate;           //moves until mate (negative if black mates), 0 if there's no mate
+    std::string bestmove; //in SAN
+    std::string pv;     //the main line, in SAN
+    bool final;         //true if the search ended by itself, false if it was cut off or is still running
+};
+
+std::string scoreToString(const analysisResult& result); //eg "+0.35", or "#3"/"#-3" for a mate
+
+//something that can search a position, every engine is only used by the analyzer's thread
+class AnalysisEngine
+{
+public:
+    virtual ~AnalysisEngine() {}
+    /* Function that searches a position until it's done or stop becomes true
+     *  input: the position, the stopflag, and a function that gets called for every new (deeper) result
+     *  output: void
+     */
+    virtual void search(Board position, const std::atomic<bool>& stop, std::function<void(const analysisResult&)> report) = 0;
+};
+
+//built-in alpha-beta search with iterative deepening and a transposition table
+class AlphaBetaEngine : public AnalysisEngine
+{
+public:
+    AlphaBetaEngine(int maxdepth = 6, int ttsizemb = 16);
+    void search(Board position, const std::atomic<bool>& stop, std::function<void(const analysisResult&)> report);
+
+private:
+    struct ttEntry
+    {
+        uint64_t key;
+        int16_t depth;
+        int8_t bound;   //TT_EXACT, TT_LOWER or TT_UPPER
+        uint16_t move;  //best move, encoded
+        int32_t score;
+    };
+
+    int negamax(Board& b, int depth, int alpha, int beta, int ply, const std::atomic<bool>& stop);
+    int quiesce(Board& b, int alpha, int beta, int ply, const std::atomic<bool>& stop);
+    int evaluate(const Board& b) const;
+    void orderMoves(const Board& b, std::vector<chessMove>* moves, uint16_t ttmove) const;
+    std::string principalVariation(Board b, int depth);
+
+    int maxdepth;
+    std::vector<ttEntry> table;
+    long nodes;
+    bool aborted;
+};
+
+//an external engine that speaks UCI, through pipes
+class UciEngine : public AnalysisEngine
+{
+public:
+    UciEngine(std::string path, int movetimems = 2000);
+    ~UciEngine();
+    bool isOpened() const { return fd >= 0; }
+    void search(Board position, const std::atomic<bool>& stop, std::function<void(const analysisResult&)> report);
+
+private:
+    void send(std::string line);
+    bool receive(std::string* line, int timeoutms);
+    bool waitFor(std::string expected, int timeoutms);
+
+    int pid;
+    int fd;         //our end of the socketpair, the engine has the other end as its stdin and stdout
+    int movetime;   //milliseconds per position, 0 to let it think until the next position comes in
+    std::string buffer;
+};
+
+class Analyzer
+{
+public:
+    Analyzer(std::unique_ptr<AnalysisEngine> engine);
+    ~Analyzer();
+
+    void analyse(const Board& position); //cancels the running search and starts on this position, never blocks
+    bool poll(analysisResult* result);   //true if there's a result that wasn't polled yet
+    bool latest(analysisResult* result) const; //the newest result, polled or not
+
+private:
+    void run();
+
+    std::unique_ptr<AnalysisEngine> engine;
+    std::thread worker;
+    mutable std::mutex lock;
+    std::condition_variable wake;
+    Board pending;
+    bool haspending;
+    bool quit;
+    std::atomic<bool> stop;
+    analysisResult result;
+    bool hasresult;
+    bool fresh;
+};
+
+#endif
@@ -0,0 +1,153 @@
+/* Tool for the binary game archive (see src/gamearchive.h)
+ * it adds pgns to an archive, finds the games that reached a position, and exports games back to pgn.
+ *   ./archive --archive=games.cga --pgn=game.pgn            add a game
+ *   ./archive --archive=games.cga --list=pgns.txt           add every pgn in the list (one path per line)
+ *   ./archive --archive=games.cga --find="<fen>"            every game that reached the position
+ *   ./archive --archive=games.cga --export=out.pgn          every game as pgn (or only --game=n, or the ones --find found)
+ */
+
+#include <sstream>
+#include "gamearchive.h"
+#include "chessdetection.h"
+
+int main(int argc, const char **argv)
+{
+    CommandLineParser parser(argc, argv,
+    "{ help h usage ?  || show this message }"
+    "{ archive a       || path to the archive }"
+    "{ pgn p           || pgn of a game to add }"
+    "{ list l          || file with on every line the path to a pgn to add }"
+    "{ find f          || fen of a position, lists every game that reached it }"
+    "{ game g          |-1| only this game (starting at 0) }"
+    "{ export e        || path to the pgn file the games are exported to }"
+    );
+
+    if (parser.has("help") || !parser.has("archive"))
+    {
+        parser.printMessage();
+        return 0;
+    }
+    string archive_location(parser.get<string>("archive"));
+
+    //adding means writing the archive again, with the games it already had
+    vector<string> pgns;
+    if (parser.has("pgn"))
+    {
+        pgns.push_back(parser.get<string>("pgn"));
+    }
+    if (parser.has("list"))
+    {
+        ifstream list(parser.get<string>("list"));
+        string line;
+        while (getline(list, line))
+        {
+            if (!line.empty() && line[0] != '#')
+            {
+                pgns.push_back(line);
+            }
+        }
+    }
+    if (!pgns.empty())
+    {
+        ArchiveLock lock(archive_location); //so a game a recognizer adds in the meantime isn't lost
+        if (!lock.isLocked())
+        {
+            return -1;
+        }
+        ArchiveWriter writer;
+        {
+            GameArchive existing;
+            if (existing.open(archive_location))
+            {
+                for (int i = 0; i < existing.games(); i++)
+                {
+                    writer.add(existing.game(i));
+                }
+            }
+        }
+        int added = 0;
+        for (int i = 0; i < pgns.size(); i++)
+        {
+            archivedGame game;
+            if (gameFromPgn(pgns[i], &game) && writer.add(game))
+            {
+                added++;
+            }
+        }
+        if (!writer.write(archive_location))
+        {
+            return -1;
+        }
+        cout << "Added " << added << " of " << pgns.size() << " games, the archive has " << writer.games() << " games" << endl;
+    }
+
+    GameArchive archive;
+    if (!archive.open(archive_location))
+    {
+        cerr << "Cannot open archive " << archive_location << endl;
+        return -1;
+    }
+
+    //the games to export: the ones that were found, one game, or all of them
+    vector<int> selection;
+    if (parser.has("find"))
+    {
+        Board board;
+        if (!board.setFen(parser.get<string>("find")))
+        {
+            cerr << "That's not a fen" << endl;
+            return -1;
+        }
+        int64 start = getTickCount();
+        vector<archivePosition> found = archive.find(board.key());
+        double ms = 1000.0*(getTickCount() - start)/getTickFrequency();
+        cout << found.size() << " times in " << archive.games() << " games (" << ms << " ms)" << endl;
+        for (int i = 0; i < found.size(); i++)
+        {
+            const archiveGameHeader& header = archive.gameHeader(found[i].game);
+            cout << "game " << found[i].game << ", ply " << found[i].ply << ": " << header.white << " - " << header.black
+                 << " " << header.date << " " << header.result << endl;
+            if (selection.empty() || selection.back() != found[i].game)
+            {
+                selection.push_back(found[i].game);
+            }
+        }
+    }
+    else if (parser.get<int>("game") >= 0)
+    {
+        int game = parser.get<int>("game");
+        if (game >= archive.games())
+        {
+            cerr << "The archive only has " << archive.games() << " games" << endl;
+            return -1;
+        }
+        selection.push_back(game);
+    }
+    else
+    {
+        for (int i = 0; i < archive.games(); i++)
+        {
+            selection.push_back(i);
+        }
+    }
+
+    if (parser.has("export"))
+    {
+        ofstream out(parser.get<string>("export"));
+        if (!out.is_open())
+        {
+            cerr << "Cannot write " << parser.get<string>("export") << endl;
+            return -1;
+        }
+        for (int i = 0; i < selection.size(); i++)
+        {
+            out << archive.toPgn(selection[i]) << endl;
+        }
+        cout << "Exported " << selection.size() << " games" << endl;
+    }
+    else if (!parser.has("find") && pgns.empty())
+    {
+        cout << archive.games() << " games" << endl;
+    }
+    return 0;
+}
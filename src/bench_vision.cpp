@@ -0,0 +1,371 @@
+/* Micro-benchmarks of the vision part of the pipeline, in the style of Google Benchmark
+ * every stage runs on its own on canned frames of the synthetic board (with the hands moving over it),
+ * at several resolutions and thread counts, and reports the time and the amount of allocations per frame.
+ *   ./bench_vision                                         every stage, at the default resolutions and thread counts
+ *   ./bench_vision --filter=dilate --resolutions=450x450 --threads=1,4 --csv=before.csv
+ * A stage runs over the frames until it took at least --mintime seconds, after one pass to warm up.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <new>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include "synthboard.h"
+#include "tiledbackground.h"
+
+#define BENCH_FRAMES 64 //canned frames per resolution
+
+//every allocation of the process: operator new (the std containers, and most of what opencv does inside)
+//and the buffers of the Mats, which opencv allocates without operator new
+static atomic<long> allocations(0);
+
+void* operator new(size_t size)
+{
+    allocations++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == NULL)
+    {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+#if CV_VERSION_MAJOR >= 4
+typedef AccessFlag accessFlag;
+#else
+typedef int accessFlag;
+#endif
+
+//counts the Mat buffers, and leaves the real work to the allocator opencv would have used
+class CountingAllocator : public MatAllocator
+{
+public:
+    CountingAllocator() : base(Mat::getStdAllocator()) {}
+    UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, accessFlag flags, UMatUsageFlags usage) const
+    {
+        if (data == NULL) //a Mat around memory that's already there doesn't allocate anything
+        {
+            allocations++;
+        }
+        return base->allocate(dims, sizes, type, data, step, flags, usage);
+    }
+    bool allocate(UMatData* data, accessFlag flags, UMatUsageFlags usage) const { return base->allocate(data, flags, usage); }
+    void deallocate(UMatData* data) const { base->deallocate(data); }
+
+private:
+    MatAllocator* base;
+};
+
+struct benchInput
+{
+    Size resolution;
+    vector<Mat> frames;         //canned frames, from the empty board to a few moves in
+    vector<Mat> masks;          //the foreground of every frame, from a background model that saw every frame before it
+    vector<Point2f> corners;    //the inner corners of the board, empty if it wasn't found at this resolution
+};
+
+struct benchStage
+{
+    string name;
+    bool threaded;  //false if the stage doesn't use more than one thread, it then only runs once
+    function<function<void(int)>(const benchInput&)> setup; //gives the function that runs the stage on frame i
+};
+
+struct benchResult
+{
+    string name;
+    Size resolution;
+    int threads;
+    double ns;      //per frame
+    double allocs;  //per frame
+    long frames;
+};
+
+/* Function that renders the canned frames of a resolution, and the foreground of every frame
+ *  input: the resolution
+ *  output: the frames, masks and corners
+ */
+benchInput makeInput(Size resolution)
+{
+    synthConfig config;
+    config.width = resolution.width;
+    config.height = resolution.height;
+    config.cell = min(resolution.width, resolution.height)/10; //the board takes up about as much of the frame at every resolution
+    config.emptyframes = 10;
+    config.settleframes = 20;
+    config.thinkframes = 20;
+    const char* moves[] = {"e4", "e5", "Nf3", "Nc6", "Bb5", "a6"};
+    SynthBoard synth(config, vector<string>(moves, moves + 6));
+
+    benchInput input;
+    input.resolution = resolution;
+    int stride = max(1, (synth.totalFrames() - config.emptyframes)/BENCH_FRAMES);
+    TiledBackground bg;
+    Mat frame, mask;
+    while (synth.nextFrame(frame) && input.frames.size() < BENCH_FRAMES)
+    {
+        if (synth.frameIndex() == 1)
+        {
+            findAllChessboardCorners(frame, &input.corners);
+        }
+        bg.apply(frame, mask);
+        if (synth.frameIndex() > config.emptyframes && (synth.frameIndex() - config.emptyframes) % stride == 0)
+        {
+            input.frames.push_back(frame.clone());
+            input.masks.push_back(mask.clone());
+        }
+    }
+    if (input.corners.size() != 49)
+    {
+        input.corners.clear();
+    }
+    return input;
+}
+
+/* Function that makes the list of stages, every one does what the pipeline does with a frame on that point
+ *  input: the amount of tiles of the background model
+ *  output: the stages
+ */
+vector<benchStage> makeStages(int tiles)
+{
+    vector<benchStage> stages;
+
+    //the background model of the recognizer, and the same model without tiles to compare with
+    stages.push_back({"MOG2", true, [tiles](const benchInput& in)
+    {
+        Ptr<TiledBackground> bg = makePtr<TiledBackground>(tiles);
+        Ptr<Mat> mask = makePtr<Mat>();
+        return function<void(int)>([bg, mask, &in](int i) { bg->apply(in.frames[i], *mask); });
+    }});
+    stages.push_back({"MOG2/untiled", true, [](const benchInput& in)
+    {
+        Ptr<TiledBackground> bg = makePtr<TiledBackground>(1);
+        Ptr<Mat> mask = makePtr<Mat>();
+        return function<void(int)>([bg, mask, &in](int i) { bg->apply(in.frames[i], *mask); });
+    }});
+
+    //the 13x13 dilate of detectMovement on its own, on the thresholded foreground
+    stages.push_back({"dilate13x13", true, [](const benchInput& in)
+    {
+        Mat element = getStructuringElement(MORPH_RECT, Size(13,13), Point(6,6));
+        Ptr<vector<Mat>> binary = makePtr<vector<Mat>>();
+        for (int i = 0; i < in.masks.size(); i++)
+        {
+            binary->push_back(in.masks[i] > 200);
+        }
+        Ptr<Mat> out = makePtr<Mat>();
+        return function<void(int)>([element, binary, out](int i) { dilate((*binary)[i], *out, element); });
+    }});
+
+    //everything detectMovement does with the mask: threshold, dilate, contours and their bounding rectangles
+    stages.push_back({"detectMovement", true, [](const benchInput& in)
+    {
+        Mat element = getStructuringElement(MORPH_RECT, Size(13,13), Point(6,6));
+        Ptr<vector<Rect>> rects = makePtr<vector<Rect>>();
+        return function<void(int)>([element, rects, &in](int i)
+        {
+            rects->clear();
+            movementAreas(in.masks[i], element, rects.get());
+        });
+    }});
+
+    //the square under every square centre, a frame here is 64 lookups
+    stages.push_back({"coordToPosition/x64", false, [](const benchInput& in)
+    {
+        Ptr<vector<Point>> centres = makePtr<vector<Point>>();
+        for (int square = 0; square < 64 && !in.corners.empty(); square++)
+        {
+            Rect r = positionToRect(squareToPosition(square), in.corners);
+            centres->push_back(Point(r.x + r.width/2, r.y + r.height/2));
+        }
+        return function<void(int)>([centres, &in](int i)
+        {
+            for (int j = 0; j < centres->size(); j++)
+            {
+                coordToPosition((*centres)[j].x, (*centres)[j].y, in.corners);
+            }
+        });
+    }});
+
+    //what the main loop does to show a frame, without the imshow: the frame, background and foreground next to each other
+    stages.push_back({"composite", true, [](const benchInput& in)
+    {
+        Ptr<Mat> frame = makePtr<Mat>();
+        Mat bg = in.frames[0].clone();
+        return function<void(int)>([frame, bg, &in](int i)
+        {
+            in.frames[i].copyTo(*frame); //the capture reads into the same Mat every frame
+            hconcat(*frame, bg, *frame);
+            Mat fgshow;
+            in.masks[i].convertTo(fgshow, CV_8UC3);
+            putText(fgshow, "100", Point(20,100), FONT_HERSHEY_SIMPLEX, 0.5, Scalar(255));
+            putText(fgshow, "lag 0 ms", Point(20,120), FONT_HERSHEY_SIMPLEX, 0.5, Scalar(255));
+            cvtColor(fgshow, fgshow, COLOR_GRAY2BGR);
+            hconcat(*frame, fgshow, *frame);
+        });
+    }});
+    return stages;
+}
+
+/* Function that times a stage: one pass over the frames to warm up, then passes until it ran long enough
+ *  input: the stage, the amount of frames, and the minimum time in seconds
+ *  output: the result, without the name, resolution and threads
+ */
+benchResult runStage(const function<void(int)>& stage, int nframes, double mintime)
+{
+    for (int i = 0; i < nframes; i++)
+    {
+        stage(i);
+    }
+
+    benchResult result;
+    result.frames = 0;
+    long allocstart = allocations;
+    int64 start = getTickCount();
+    double elapsed = 0;
+    while (elapsed < mintime)
+    {
+        for (int i = 0; i < nframes; i++)
+        {
+            stage(i);
+        }
+        result.frames += nframes;
+        elapsed = (getTickCount() - start)/getTickFrequency();
+    }
+    result.ns = 1e9*elapsed/result.frames;
+    result.allocs = (double)(allocations - allocstart)/result.frames;
+    return result;
+}
+
+//"320x240,640x480" or "1,2,4"
+vector<Size> parseResolutions(string list)
+{
+    vector<Size> sizes;
+    istringstream in(list);
+    string item;
+    while (getline(in, item, ','))
+    {
+        int w, h;
+        if (sscanf(item.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0)
+        {
+            sizes.push_back(Size(w, h));
+        }
+    }
+    return sizes;
+}
+
+vector<int> parseThreads(string list)
+{
+    vector<int> threads;
+    istringstream in(list);
+    string item;
+    while (getline(in, item, ','))
+    {
+        int n = item == "max" ? getNumberOfCPUs() : atoi(item.c_str());
+        if (n > 0 && find(threads.begin(), threads.end(), n) == threads.end())
+        {
+            threads.push_back(n);
+        }
+    }
+    return threads;
+}
+
+int main(int argc, const char **argv)
+{
+    CommandLineParser parser(argc, argv,
+    "{ help h usage ?  || show this message }"
+    "{ filter f        || only the stages with this in their name }"
+    "{ resolutions r   |320x240,450x450,640x480,1280x720| resolutions of the frames (450x450 is what chessdetection resizes to) }"
+    "{ threads t       |1,2,4,max| thread counts, 'max' is the amount of cores }"
+    "{ tiles           |4| tiles per side of the background model }"
+    "{ mintime         |0.5| minimum amount of seconds a stage runs }"
+    "{ csv             || path to a csv file the results are written to as well }"
+    );
+
+    if (parser.has("help"))
+    {
+        parser.printMessage();
+        return 0;
+    }
+    string filter(parser.get<string>("filter"));
+    vector<Size> resolutions = parseResolutions(parser.get<string>("resolutions"));
+    vector<int> threadcounts = parseThreads(parser.get<string>("threads"));
+    double mintime = parser.get<double>("mintime");
+    if (resolutions.empty() || threadcounts.empty())
+    {
+        cerr << "No resolutions or thread counts to run" << endl;
+        return -1;
+    }
+
+    static CountingAllocator counting; //has to outlive every Mat
+    Mat::setDefaultAllocator(&counting);
+
+    vector<benchStage> stages = makeStages(parser.get<int>("tiles"));
+    vector<benchResult> results;
+    cout << left << setw(44) << "Benchmark" << right << setw(14) << "ns/frame" << setw(14) << "allocs/frame" << setw(10) << "frames" << endl;
+    cout << string(82, '-') << endl;
+    for (int r = 0; r < resolutions.size(); r++)
+    {
+        benchInput input = makeInput(resolutions[r]);
+        string resolution = to_string(resolutions[r].width) + "x" + to_string(resolutions[r].height);
+        if (input.frames.empty())
+        {
+            cout << resolution << ": the synthetic board didn't render any frames" << endl;
+            continue;
+        }
+        for (int s = 0; s < stages.size(); s++)
+        {
+            if (!filter.empty() && stages[s].name.find(filter) == string::npos)
+            {
+                continue;
+            }
+            if (stages[s].name.find("coordToPosition") == 0 && input.corners.empty())
+            {
+                cout << stages[s].name << "/" << resolution << ": the board wasn't found at this resolution" << endl;
+                continue;
+            }
+            for (int t = 0; t < threadcounts.size(); t++)
+            {
+                if (!stages[s].threaded && t > 0)
+                {
+                    break;
+                }
+                int threads = stages[s].threaded ? threadcounts[t] : 1;
+                setNumThreads(threads);
+                function<void(int)> stage = stages[s].setup(input);
+                benchResult result = runStage(stage, input.frames.size(), mintime);
+                result.name = stages[s].name;
+                result.resolution = resolutions[r];
+                result.threads = threads;
+                results.push_back(result);
+
+                string name = result.name + "/" + resolution + "/threads:" + to_string(threads);
+                cout << left << setw(44) << name << right << setw(14) << fixed << setprecision(0) << result.ns
+                     << setw(14) << setprecision(1) << result.allocs << setw(10) << result.frames << endl;
+            }
+        }
+    }
+    setNumThreads(-1);
+
+    if (parser.has("csv"))
+    {
+        ofstream csv(parser.get<string>("csv"));
+        csv << "stage,width,height,threads,ns_per_frame,allocs_per_frame,frames" << endl;
+        for (int i = 0; i < results.size(); i++)
+        {
+            csv << results[i].name << "," << results[i].resolution.width << "," << results[i].resolution.height << ","
+                << results[i].threads << "," << fixed << setprecision(0) << results[i].ns << ","
+                << setprecision(2) << results[i].allocs << "," << results[i].frames << endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,919 @@
+/* Chess rules: the position on the board, legal move generation and the algebraic notation
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include "board.h"
+
+using namespace std;
+
+static const int knightsteps[8][2] = {{1,2}, {2,1}, {2,-1}, {1,-2}, {-1,-2}, {-2,-1}, {-2,1}, {-1,2}};
+static const int bishopsteps[4][2] = {{1,1}, {1,-1}, {-1,1}, {-1,-1}};
+static const int rooksteps[4][2] = {{1,0}, {-1,0}, {0,1}, {0,-1}};
+static const int kingsteps[8][2] = {{1,1}, {1,-1}, {-1,1}, {-1,-1}, {1,0}, {-1,0}, {0,1}, {0,-1}};
+
+/* Function that gives the name of a square
+ *  input: the square
+ *  output: the name of the square (eg "e4")
+ */
+string squareToString(int square)
+{
+    string name = "";
+    name += (char)('a' + fileOf(square));
+    name += (char)('1' + rankOf(square));
+    return name;
+}
+
+/* Function that gives the letter a piece gets in the algebraic notation
+ *  input: the number of the piece
+ *  output: the letter, or an empty string for pawns
+ */
+static string pieceLetter(int nr)
+{
+    switch(nr){
+        case KING_W: case KING_B: return "K";
+        case QUEEN_W: case QUEEN_B: return "Q";
+        case ROOK_W: case ROOK_B: return "R";
+        case BISH_W: case BISH_B: return "B";
+        case KNIGHT_W: case KNIGHT_B: return "N";
+    }
+    return "";
+}
+
+static bool onBoard(int rank, int file)
+{
+    return 0 <= rank && rank < 8 && 0 <= file && file < 8;
+}
+
+//random numbers for every piece on every square, and for the rest of the state
+struct ZobristTable
+{
+    uint64_t pieces[12][64];
+    uint64_t castling[16];
+    uint64_t epfile[8];
+    uint64_t blacktomove;
+};
+
+/* Function that gives the zobrist table, which is the same in every run (and every process)
+ * so keys can be stored and compared between recognizers
+ *  input: void
+ *  output: the table
+ */
+static const ZobristTable& zobristTable()
+{
+    //a function-local static is initialised exactly once, even when boards are made on several threads at the same time
+    static const ZobristTable table = []() {
+        ZobristTable t;
+        uint64_t state = 0x9E3779B97F4A7C15ull; //fixed seed
+        auto next = [&state]() {
+            //splitmix64
+            uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27))*0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        };
+        for (int nr = 0; nr < 12; nr++)
+        {
+            for (int square = 0; square < 64; square++)
+            {
+                t.pieces[nr][square] = next();
+            }
+        }
+        t.castling[0] = 0; //no castling rights doesn't change the key
+        for (int i = 1; i < 16; i++)
+        {
+            t.castling[i] = next();
+        }
+        for (int i = 0; i < 8; i++)
+        {
+            t.epfile[i] = next();
+        }
+        t.blacktomove = next();
+        return t;
+    }();
+    return table;
+}
+
+uint16_t encodeMove(chessMove m)
+{
+    int promotion = m.promotion == NO_PIECE ? 0 : m.promotion + 1;
+    return m.from | (m.to << 6) | (promotion << 12);
+}
+
+chessMove decodeMove(uint16_t code)
+{
+    chessMove m;
+    m.from = code & 63;
+    m.to = (code >> 6) & 63;
+    int promotion = code >> 12;
+    m.promotion = promotion == 0 ? NO_PIECE : promotion - 1;
+    return m;
+}
+
+Board::Board()
+{
+    reset();
+}
+
+void Board::putPiece(int square, int nr)
+{
+    squares[square] = nr;
+    zobrist ^= zobristTable().pieces[nr][square];
+}
+
+void Board::removePiece(int square)
+{
+    zobrist ^= zobristTable().pieces[squares[square]][square];
+    squares[square] = NO_PIECE;
+}
+
+/* Function that tells whether the en passant square is part of the zobrist key
+ * only when a pawn of the side to move can actually take, otherwise the position is the same as without the double step
+ * (a pawn that's pinned still counts, like in the keys of the polyglot opening books)
+ *  input: void
+ *  output: true if there's an en passant square with a pawn of the side to move next to the pawn that made the double step
+ */
+bool Board::epCapturable() const
+{
+    if (epsquare == NO_PIECE)
+    {
+        return false;
+    }
+    int rank = whitetomove ? rankOf(epsquare) - 1 : rankOf(epsquare) + 1; //where the pawn that made the double step is
+    int pawn = whitetomove ? PAWN_W : PAWN_B;
+    int file = fileOf(epsquare);
+    return (file > 0 && squares[squareOf(rank, file - 1)] == pawn) || (file < 7 && squares[squareOf(rank, file + 1)] == pawn);
+}
+
+/* Function that calculates the zobrist key from scratch, after the position was set up
+ *  input: void
+ *  output: void
+ */
+void Board::computeKey()
+{
+    const ZobristTable& z = zobristTable();
+    zobrist = 0;
+    for (int square = 0; square < 64; square++)
+    {
+        if (squares[square] != NO_PIECE)
+        {
+            zobrist ^= z.pieces[squares[square]][square];
+        }
+    }
+    zobrist ^= z.castling[castling];
+    if (epCapturable())
+    {
+        zobrist ^= z.epfile[fileOf(epsquare)];
+    }
+    if (!whitetomove)
+    {
+        zobrist ^= z.blacktomove;
+    }
+
+    history.clear();
+    movelist.clear();
+    keylist.clear();
+    seen.clear();
+    seen[zobrist] = 1;
+}
+
+void Board::reset()
+{
+    const int backrank[8] = {ROOK_W, KNIGHT_W, BISH_W, QUEEN_W, KING_W, BISH_W, KNIGHT_W, ROOK_W};
+    for (int i = 0; i < 64; i++)
+    {
+        squares[i] = NO_PIECE;
+    }
+    for (int file = 0; file < 8; file++)
+    {
+        squares[squareOf(0, file)] = backrank[file];
+        squares[squareOf(1, file)] = PAWN_W;
+        squares[squareOf(6, file)] = PAWN_B;
+        squares[squareOf(7, file)] = backrank[file] - 1; //the black piece is always one lower than the white one
+    }
+    whitetomove = true;
+    castling = CASTLE_WK | CASTLE_WQ | CASTLE_BK | CASTLE_BQ;
+    epsquare = NO_PIECE;
+    halfmoves = 0;
+    computeKey();
+}
+
+static const string fenletters = "pPkKqQbBnNrR"; //in the order of the piece numbers
+
+/* Function that sets up a position from its FEN description
+ *  input: the FEN (eg "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1")
+ *  output: false if the FEN couldn't be read or isn't a position (not 8 by 8 squares, not one king per side, an en passant
+ *          square that can't be), the board is then back in the starting position
+ */
+bool Board::setFen(string fen)
+{
+    istringstream fields(fen);
+    string placement, side, rights, ep;
+    int clock = 0;
+    if (!(fields >> placement >> side))
+    {
+        reset();
+        return false;
+    }
+    fields >> rights >> ep >> clock;
+
+    for (int i = 0; i < 64; i++)
+    {
+        squares[i] = NO_PIECE;
+    }
+    //8 ranks of 8 files, every one of them filled in
+    int rank = 7;
+    int file = 0;
+    for (int i = 0; i < placement.size(); i++)
+    {
+        char c = placement[i];
+        if (c == '/' && file == 8 && rank > 0)
+        {
+            rank--;
+            file = 0;
+        }
+        else if (c >= '1' && c <= '8' && file + (c - '0') <= 8)
+        {
+            file += c - '0';
+        }
+        else if (fenletters.find(c) != string::npos && onBoard(rank, file))
+        {
+            squares[squareOf(rank, file)] = fenletters.find(c);
+            file++;
+        }
+        else
+        {
+            reset();
+            return false;
+        }
+    }
+    //one king per side, or there's nothing to generate moves for
+    int whitekings = 0;
+    int blackkings = 0;
+    for (int i = 0; i < 64; i++)
+    {
+        whitekings += squares[i] == KING_W;
+        blackkings += squares[i] == KING_B;
+    }
+    if (rank != 0 || file != 8 || whitekings != 1 || blackkings != 1 || (side != "w" && side != "b"))
+    {
+        reset();
+        return false;
+    }
+
+    whitetomove = side == "w";
+    castling = 0;
+    castling |= rights.find('K') != string::npos ? CASTLE_WK : 0;
+    castling |= rights.find('Q') != string::npos ? CASTLE_WQ : 0;
+    castling |= rights.find('k') != string::npos ? CASTLE_BK : 0;
+    castling |= rights.find('q') != string::npos ? CASTLE_BQ : 0;
+    epsquare = NO_PIECE;
+    if (!ep.empty() && ep != "-")
+    {//the square behind a pawn that just moved two squares, so on the third or the sixth rank
+        if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] != (whitetomove ? '6' : '3'))
+        {
+            reset();
+            return false;
+        }
+        epsquare = squareOf(ep[1] - '1', ep[0] - 'a');
+    }
+    halfmoves = clock;
+    computeKey();
+    return true;
+}
+
+/* Function that describes the position as a FEN
+ *  input: void
+ *  output: the FEN
+ */
+string Board::toFen() const
+{
+    string fen = "";
+    for (int rank = 7; rank >= 0; rank--)
+    {
+        int empty = 0;
+        for (int file = 0; file < 8; file++)
+        {
+            int nr = squares[squareOf(rank, file)];
+            if (nr == NO_PIECE)
+            {
+                empty++;
+                continue;
+            }
+            if (empty > 0)
+            {
+                fen += to_string(empty);
+                empty = 0;
+            }
+            fen += fenletters[nr];
+        }
+        if (empty > 0)
+        {
+            fen += to_string(empty);
+        }
+        if (rank > 0)
+        {
+            fen += "/";
+        }
+    }
+
+    fen += whitetomove ? " w " : " b ";
+    string rights = "";
+    rights += (castling & CASTLE_WK) ? "K" : "";
+    rights += (castling & CASTLE_WQ) ? "Q" : "";
+    rights += (castling & CASTLE_BK) ? "k" : "";
+    rights += (castling & CASTLE_BQ) ? "q" : "";
+    fen += rights.empty() ? "-" : rights;
+    fen += " " + (epsquare == NO_PIECE ? string("-") : squareToString(epsquare));
+    fen += " " + to_string(halfmoves) + " " + to_string(1 + history.size()/2);
+    return fen;
+}
+
+/* Function that checks if a square is attacked by one of the players
+ *  input: the square, and which player attacks it
+ *  output: true if a piece of that player could capture on the square
+ */
+bool Board::isAttacked(int square, bool bywhite) const
+{
+    int rank = rankOf(square);
+    int file = fileOf(square);
+    int colour = bywhite ? 1 : 0;
+
+    //pawns attack diagonally forward, so look diagonally backward from the square
+    int pawnrank = rank + (bywhite ? -1 : 1);
+    for (int df = -1; df < 2; df += 2)
+    {
+        if (onBoard(pawnrank, file + df) && squares[squareOf(pawnrank, file + df)] == PAWN_B + colour)
+        {
+            return true;
+        }
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        int r = rank + knightsteps[i][1];
+        int f = file + knightsteps[i][0];
+        if (onBoard(r, f) && squares[squareOf(r, f)] == KNIGHT_B + colour)
+        {
+            return true;
+        }
+        r = rank + kingsteps[i][1];
+        f = file + kingsteps[i][0];
+        if (onBoard(r, f) && squares[squareOf(r, f)] == KING_B + colour)
+        {
+            return true;
+        }
+    }
+    //sliding pieces: walk every direction until we hit something
+    for (int i = 0; i < 8; i++)
+    {
+        bool diagonal = i < 4;
+        int r = rank + kingsteps[i][1];
+        int f = file + kingsteps[i][0];
+        while (onBoard(r, f))
+        {
+            int nr = squares[squareOf(r, f)];
+            if (nr != NO_PIECE)
+            {
+                if (nr == QUEEN_B + colour || nr == (diagonal ? BISH_B : ROOK_B) + colour)
+                {
+                    return true;
+                }
+                break;
+            }
+            r += kingsteps[i][1];
+            f += kingsteps[i][0];
+        }
+    }
+    return false;
+}
+
+bool Board::inCheck() const
+{
+    int king = whitetomove ? KING_W : KING_B;
+    for (int i = 0; i < 64; i++)
+    {
+        if (squares[i] == king)
+        {
+            return isAttacked(i, !whitetomove);
+        }
+    }
+    return false;
+}
+
+void Board::addStepMoves(int from, const int (*steps)[2], int nsteps, bool slide, vector<chessMove>* moves) const
+{
+    bool white = isWhite(squares[from]);
+    for (int i = 0; i < nsteps; i++)
+    {
+        int r = rankOf(from) + steps[i][1];
+        int f = fileOf(from) + steps[i][0];
+        while (onBoard(r, f))
+        {
+            int to = squareOf(r, f);
+            if (squares[to] != NO_PIECE && isWhite(squares[to]) == white)
+            {
+                break; //own piece in the way
+            }
+            chessMove m = {from, to, NO_PIECE};
+            (*moves).push_back(m);
+            if (squares[to] != NO_PIECE || !slide)
+            {
+                break;
+            }
+            r += steps[i][1];
+            f += steps[i][0];
+        }
+    }
+}
+
+void Board::addPawnMoves(int from, vector<chessMove>* moves) const
+{
+    bool white = isWhite(squares[from]);
+    int dir = white ? 1 : -1;
+    int startrank = white ? 1 : 6;
+    int promorank = white ? 7 : 0;
+    int rank = rankOf(from);
+    int file = fileOf(from);
+    const int promotions[4] = {QUEEN_B, ROOK_B, BISH_B, KNIGHT_B};
+
+    vector<int> targets;
+    //straight forward, only onto empty squares
+    if (onBoard(rank + dir, file) && squares[squareOf(rank + dir, file)] == NO_PIECE)
+    {
+        targets.push_back(squareOf(rank + dir, file));
+        if (rank == startrank && squares[squareOf(rank + 2*dir, file)] == NO_PIECE)
+        {
+            targets.push_back(squareOf(rank + 2*dir, file));
+        }
+    }
+    //diagonally, only when capturing
+    for (int df = -1; df < 2; df += 2)
+    {
+        if (!onBoard(rank + dir, file + df))
+        {
+            continue;
+        }
+        int to = squareOf(rank + dir, file + df);
+        if ((squares[to] != NO_PIECE && isWhite(squares[to]) != white) || to == epsquare)
+        {
+            targets.push_back(to);
+        }
+    }
+
+    for (int i = 0; i < targets.size(); i++)
+    {
+        if (rankOf(targets[i]) == promorank)
+        {
+            for (int p = 0; p < 4; p++)
+            {
+                chessMove m = {from, targets[i], promotions[p] + (white ? 1 : 0)};
+                (*moves).push_back(m);
+            }
+        }
+        else
+        {
+            chessMove m = {from, targets[i], NO_PIECE};
+            (*moves).push_back(m);
+        }
+    }
+}
+
+void Board::addCastlingMoves(vector<chessMove>* moves) const
+{
+    int base = whitetomove ? 0 : 56; //a1 or a8
+    int rook = whitetomove ? ROOK_W : ROOK_B;
+    int kingside = whitetomove ? CASTLE_WK : CASTLE_BK;
+    int queenside = whitetomove ? CASTLE_WQ : CASTLE_BQ;
+    if (squares[base + 4] != (whitetomove ? KING_W : KING_B) || isAttacked(base + 4, !whitetomove))
+    {
+        return;
+    }
+    //the king can't pass through or land on an attacked square
+    if ((castling & kingside) && squares[base + 7] == rook && squares[base + 5] == NO_PIECE && squares[base + 6] == NO_PIECE
+        && !isAttacked(base + 5, !whitetomove) && !isAttacked(base + 6, !whitetomove))
+    {
+        chessMove m = {base + 4, base + 6, NO_PIECE};
+        (*moves).push_back(m);
+    }
+    if ((castling & queenside) && squares[base] == rook && squares[base + 1] == NO_PIECE && squares[base + 2] == NO_PIECE && squares[base + 3] == NO_PIECE
+        && !isAttacked(base + 3, !whitetomove) && !isAttacked(base + 2, !whitetomove))
+    {
+        chessMove m = {base + 4, base + 2, NO_PIECE};
+        (*moves).push_back(m);
+    }
+}
+
+void Board::pseudoLegalMoves(vector<chessMove>* moves) const
+{
+    for (int from = 0; from < 64; from++)
+    {
+        int nr = squares[from];
+        if (nr == NO_PIECE || isWhite(nr) != whitetomove)
+        {
+            continue;
+        }
+        switch(nr){
+            case PAWN_W: case PAWN_B: addPawnMoves(from, moves); break;
+            case KNIGHT_W: case KNIGHT_B: addStepMoves(from, knightsteps, 8, false, moves); break;
+            case BISH_W: case BISH_B: addStepMoves(from, bishopsteps, 4, true, moves); break;
+            case ROOK_W: case ROOK_B: addStepMoves(from, rooksteps, 4, true, moves); break;
+            case QUEEN_W: case QUEEN_B: addStepMoves(from, kingsteps, 8, true, moves); break;
+            case KING_W: case KING_B: addStepMoves(from, kingsteps, 8, false, moves); break;
+        }
+    }
+    addCastlingMoves(moves);
+}
+
+/* Function that generates all the legal moves of the player whose turn it is
+ * it generates every move the pieces can make, and throws out the ones that leave the own king in check
+ *  input: void
+ *  output: the legal moves
+ */
+vector<chessMove> Board::legalMoves()
+{
+    vector<chessMove> pseudo;
+    pseudoLegalMoves(&pseudo);
+
+    vector<chessMove> legal;
+    for (int i = 0; i < pseudo.size(); i++)
+    {
+        makeMove(pseudo[i]);
+        //after makeMove it's the other player's turn, so inCheck can't be used here
+        int king = whitetomove ? KING_B : KING_W;
+        bool incheck = false;
+        for (int sq = 0; sq < 64; sq++)
+        {
+            if (squares[sq] == king)
+            {
+                incheck = isAttacked(sq, whitetomove);
+                break;
+            }
+        }
+        unmakeMove();
+        if (!incheck)
+        {
+            legal.push_back(pseudo[i]);
+        }
+    }
+    return legal;
+}
+
+bool Board::isLegal(chessMove m)
+{
+    vector<chessMove> legal = legalMoves();
+    for (int i = 0; i < legal.size(); i++)
+    {
+        if (legal[i].from == m.from && legal[i].to == m.to && legal[i].promotion == m.promotion)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Function that plays a move on the board, the move is not checked for legality
+ * the zobrist key is updated along the way, by xor-ing out what leaves a square and xor-ing in what arrives
+ *  input: the move
+ *  output: void
+ */
+void Board::makeMove(chessMove m)
+{
+    const ZobristTable& z = zobristTable();
+    undoInfo u;
+    u.m = m;
+    u.moved = squares[m.from];
+    u.captured = squares[m.to];
+    u.castling = castling;
+    u.epsquare = epsquare;
+    u.halfmoves = halfmoves;
+    history.push_back(u);
+    movelist.push_back(encodeMove(m));
+    keylist.push_back(zobrist);
+
+    bool pawn = u.moved == PAWN_W || u.moved == PAWN_B;
+    bool king = u.moved == KING_W || u.moved == KING_B;
+    bool ephashed = epCapturable(); //before anything moves, it has to come out of the key the way it went in
+
+    //en passant: the captured pawn isn't on the square the pawn moves to
+    if (pawn && m.to == epsquare)
+    {
+        int capturedsquare = squareOf(rankOf(m.from), fileOf(m.to));
+        history.back().captured = squares[capturedsquare];
+        removePiece(capturedsquare);
+    }
+    //castling: the king moves two files, the rook jumps over it
+    if (king && abs(fileOf(m.to) - fileOf(m.from)) == 2)
+    {
+        int base = squareOf(rankOf(m.from), 0);
+        int rookfrom = fileOf(m.to) == 6 ? base + 7 : base;
+        int rookto = fileOf(m.to) == 6 ? base + 5 : base + 3;
+        putPiece(rookto, squares[rookfrom]);
+        removePiece(rookfrom);
+    }
+
+    if (squares[m.to] != NO_PIECE)
+    {
+        removePiece(m.to);
+    }
+    putPiece(m.to, m.promotion != NO_PIECE ? m.promotion : u.moved);
+    removePiece(m.from);
+
+    //a king or rook that moves (or a rook that gets captured) loses its castling rights
+    const int castlesquares[6] = {4, 0, 7, 60, 56, 63};
+    const int castlerights[6] = {CASTLE_WK | CASTLE_WQ, CASTLE_WQ, CASTLE_WK, CASTLE_BK | CASTLE_BQ, CASTLE_BQ, CASTLE_BK};
+    zobrist ^= z.castling[castling];
+    for (int i = 0; i < 6; i++)
+    {
+        if (m.from == castlesquares[i] || m.to == castlesquares[i])
+        {
+            castling &= ~castlerights[i];
+        }
+    }
+    zobrist ^= z.castling[castling];
+
+    if (ephashed)
+    {
+        zobrist ^= z.epfile[fileOf(epsquare)];
+    }
+    epsquare = NO_PIECE;
+    if (pawn && abs(m.to - m.from) == 16)
+    {
+        epsquare = (m.from + m.to)/2;
+    }
+    halfmoves = (pawn || history.back().captured != NO_PIECE) ? 0 : halfmoves + 1;
+    whitetomove = !whitetomove;
+    zobrist ^= z.blacktomove;
+    if (epCapturable())
+    {
+        zobrist ^= z.epfile[fileOf(epsquare)];
+    }
+    seen[zobrist]++;
+}
+
+/* Function that takes back the last move that was played with makeMove
+ *  input: void
+ *  output: void
+ */
+void Board::unmakeMove()
+{
+    if (history.empty())
+    {
+        return;
+    }
+    undoInfo u = history.back();
+    history.pop_back();
+    chessMove m = u.m;
+
+    if (--seen[zobrist] == 0)
+    {
+        seen.erase(zobrist);
+    }
+    zobrist = keylist.back();
+    keylist.pop_back();
+    movelist.pop_back();
+
+    whitetomove = !whitetomove;
+    castling = u.castling;
+    epsquare = u.epsquare;
+    halfmoves = u.halfmoves;
+
+    squares[m.from] = u.moved;
+    squares[m.to] = u.captured;
+
+    bool pawn = u.moved == PAWN_W || u.moved == PAWN_B;
+    bool king = u.moved == KING_W || u.moved == KING_B;
+    if (pawn && m.to == u.epsquare)
+    {
+        squares[m.to] = NO_PIECE;
+        squares[squareOf(rankOf(m.from), fileOf(m.to))] = u.captured;
+    }
+    if (king && abs(fileOf(m.to) - fileOf(m.from)) == 2)
+    {
+        int base = squareOf(rankOf(m.from), 0);
+        int rookfrom = fileOf(m.to) == 6 ? base + 7 : base;
+        int rookto = fileOf(m.to) == 6 ? base + 5 : base + 3;
+        squares[rookfrom] = squares[rookto];
+        squares[rookto] = NO_PIECE;
+    }
+}
+
+/* Function that counts how often the current position was on the board
+ * thanks to the table of keys this is a lookup, instead of going through the whole game
+ *  input: void
+ *  output: the amount of times, including now (so 3 is a threefold repetition)
+ */
+int Board::repetitions() const
+{
+    auto found = seen.find(zobrist);
+    return found == seen.end() ? 0 : found->second;
+}
+
+/* Function that writes a move in the standard algebraic notation, the way it's written in a pgn
+ *  input: the move (which has to be legal)
+ *  output: the notation (eg "Nbd7", "exd5", "e8=Q+", "O-O")
+ */
+string Board::toSan(chessMove m)
+{
+    int nr = squares[m.from];
+    bool pawn = nr == PAWN_W || nr == PAWN_B;
+    bool capture = squares[m.to] != NO_PIECE || (pawn && m.to == epsquare);
+    string san = "";
+
+    if ((nr == KING_W || nr == KING_B) && abs(fileOf(m.to) - fileOf(m.from)) == 2)
+    {
+        san = fileOf(m.to) == 6 ? "O-O" : "O-O-O";
+    }
+    else if (pawn)
+    {
+        if (capture)
+        {
+            san += (char)('a' + fileOf(m.from));
+            san += "x";
+        }
+        san += squareToString(m.to);
+        if (m.promotion != NO_PIECE)
+        {
+            san += "=" + pieceLetter(m.promotion);
+        }
+    }
+    else
+    {
+        san += pieceLetter(nr);
+        //when another piece of the same kind can go to the same square, add its file or rank
+        vector<chessMove> legal = legalMoves();
+        bool ambiguous = false;
+        bool samefile = false;
+        bool samerank = false;
+        for (int i = 0; i < legal.size(); i++)
+        {
+            if (legal[i].to == m.to && legal[i].from != m.from && squares[legal[i].from] == nr)
+            {
+                ambiguous = true;
+                samefile |= fileOf(legal[i].from) == fileOf(m.from);
+                samerank |= rankOf(legal[i].from) == rankOf(m.from);
+            }
+        }
+        if (ambiguous)
+        {
+            if (!samefile)
+            {
+                san += (char)('a' + fileOf(m.from));
+            }
+            else if (!samerank)
+            {
+                san += (char)('1' + rankOf(m.from));
+            }
+            else
+            {
+                san += squareToString(m.from);
+            }
+        }
+        if (capture)
+        {
+            san += "x";
+        }
+        san += squareToString(m.to);
+    }
+
+    makeMove(m);
+    if (inCheck())
+    {
+        san += legalMoves().empty() ? "#" : "+";
+    }
+    unmakeMove();
+    return san;
+}
+
+/* Function that reads a move in the standard algebraic notation
+ *  input: the notation (checks and annotations are allowed), and a pointer to the move to fill in
+ *  output: true if it's a legal move in this position
+ */
+bool Board::parseSan(string san, chessMove* m)
+{
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?'))
+    {
+        san.pop_back();
+    }
+    for (int i = 0; i < san.size(); i++)
+    {
+        if (san[i] == '0')
+        {
+            san[i] = 'O'; //"0-0" is sometimes used for castling
+        }
+    }
+    //promotions are sometimes written without the "=" (eg "e8Q")
+    if (san.size() > 2 && isdigit(san[san.size() - 2]) && string("QRBN").find(san.back()) != string::npos)
+    {
+        san.insert(san.size() - 1, "=");
+    }
+
+    vector<chessMove> legal = legalMoves();
+    for (int i = 0; i < legal.size(); i++)
+    {
+        string candidate = toSan(legal[i]);
+        while (!candidate.empty() && (candidate.back() == '+' || candidate.back() == '#'))
+        {
+            candidate.pop_back();
+        }
+        if (candidate == san)
+        {
+            *m = legal[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Function that reads all the moves out of a pgn file
+ * tags, comments, variations, movenumbers and the result are skipped
+ *  input: the path to the pgn
+ *  output: the moves of the game, in the order they were played
+ */
+vector<string> readPgnMoves(string path)
+{
+    vector<string> moves;
+    ifstream file(path);
+    if (!file.is_open())
+    {
+        cerr << "Cannot open pgn " << path << endl;
+        return moves;
+    }
+
+    //first strip everything that isn't a move
+    string text;
+    string line;
+    while (getline(file, line))
+    {
+        if (!line.empty() && line[0] == '[')
+        {
+            continue; //tag pair
+        }
+        size_t semicolon = line.find(';');
+        if (semicolon != string::npos)
+        {
+            line = line.substr(0, semicolon); //comment till the end of the line
+        }
+        text += line + " ";
+    }
+
+    string stripped;
+    int commentdepth = 0;
+    int variationdepth = 0;
+    for (int i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        if (c == '{') commentdepth++;
+        else if (c == '}') commentdepth--;
+        else if (commentdepth == 0 && c == '(') variationdepth++;
+        else if (commentdepth == 0 && c == ')') variationdepth--;
+        else if (commentdepth == 0 && variationdepth == 0) stripped += c;
+    }
+
+    istringstream tokens(stripped);
+    string token;
+    while (tokens >> token)
+    {
+        //remove the movenumber in front of the move ("12." or "12...")
+        size_t start = 0;
+        while (start < token.size() && (isdigit(token[start]) || token[start] == '.'))
+        {
+            start++;
+        }
+        if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*")
+        {
+            break;
+        }
+        token = token.substr(start);
+        if (token.empty() || token[0] == '$')
+        {
+            continue; //only a movenumber, or an annotation glyph
+        }
+        moves.push_back(token);
+    }
+    return moves;
+}
+
+/* Function that writes a time the way the %clk and %emt comments of a pgn want it
+ *  input: the time in milliseconds, and whether to add the tenths of a second
+ *  output: the time as h:mm:ss (or h:mm:ss.t), negative times become 0:00:00
+ */
+string clockToString(double ms, bool tenths)
+{
+    long t = ms > 0 ? (long)(ms/100 + 0.5) : 0; //in tenths of a second
+    if (!tenths)
+    {
+        t = (t + 5)/10*10;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), "%ld:%02ld:%02ld", t/36000, t/600%60, t/10%60);
+    string s = text;
+    if (tenths)
+    {
+        s += "." + to_string(t%10);
+    }
+    return s;
+}
@@ -0,0 +1,117 @@
+/* Chess rules: the position on the board, legal move generation and the algebraic notation
+ * this part doesn't know anything about cameras, so it can be used by every tool
+ */
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#define PAWN_B 0
+#define PAWN_W 1
+#define KING_B 2
+#define KING_W 3
+#define QUEEN_B 4
+#define QUEEN_W 5
+#define BISH_B 6
+#define BISH_W 7
+#define KNIGHT_B 8
+#define KNIGHT_W 9
+#define ROOK_B 10
+#define ROOK_W 11
+
+#define NO_PIECE -1 //no piece on the square
+
+//castling rights
+#define CASTLE_WK 1
+#define CASTLE_WQ 2
+#define CASTLE_BK 4
+#define CASTLE_BQ 8
+
+//squares are numbered rank*8+file, so a1 is 0, h1 is 7 and h8 is 63
+inline int squareOf(int rank, int file) { return rank*8 + file; }
+inline int rankOf(int square) { return square/8; }
+inline int fileOf(int square) { return square%8; }
+inline bool isWhite(int nr) { return nr%2 == 1; }
+std::string squareToString(int square);
+std::vector<std::string> readPgnMoves(std::string path);
+std::string clockToString(double ms, bool tenths = false); //h:mm:ss, as in the %clk and %emt comments of a pgn
+
+struct chessMove
+{
+    int from;
+    int to;
+    int promotion; //the piece a pawn promotes to, NO_PIECE if it isn't a promotion
+};
+
+//a move in 16 bits: 6 bits from, 6 bits to and 4 bits promotion (0 for none, else the piece number + 1)
+uint16_t encodeMove(chessMove m);
+chessMove decodeMove(uint16_t code);
+
+class Board
+{
+public:
+    Board();
+
+    void reset(); //back to the starting position
+    bool setFen(std::string fen);
+    std::string toFen() const;
+    int at(int square) const { return squares[square]; }
+    bool whiteToMove() const { return whitetomove; }
+    int ply() const { return history.size(); }
+
+    //zobrist key of the position, updated with every makeMove and unmakeMove
+    uint64_t key() const { return zobrist; }
+    int repetitions() const;  //how often the current position was on the board, 3 means threefold repetition
+    bool fiftyMoves() const { return halfmoves >= 100; }
+    int halfmoveClock() const { return halfmoves; }
+    const std::vector<uint16_t>& plies() const { return movelist; } //every move that was played, encoded
+    const std::vector<uint64_t>& keys() const { return keylist; }   //the key before every move that was played
+
+    std::vector<chessMove> legalMoves();
+    bool isLegal(chessMove m);
+    void makeMove(chessMove m);
+    void unmakeMove();
+    bool isAttacked(int square, bool bywhite) const;
+    bool inCheck() const;
+
+    std::string toSan(chessMove m);
+    bool parseSan(std::string san, chessMove* m);
+
+private:
+    //everything makeMove changes that can't be recalculated from the move itself
+    struct undoInfo
+    {
+        chessMove m;
+        int moved;
+        int captured;
+        int castling;
+        int epsquare;
+        int halfmoves;
+    };
+
+    void pseudoLegalMoves(std::vector<chessMove>* moves) const;
+    void addPawnMoves(int from, std::vector<chessMove>* moves) const;
+    void addStepMoves(int from, const int (*steps)[2], int nsteps, bool slide, std::vector<chessMove>* moves) const;
+    void addCastlingMoves(std::vector<chessMove>* moves) const;
+    void computeKey();
+    bool epCapturable() const; //true if a pawn of the side to move stands next to the pawn that can be taken en passant
+    void putPiece(int square, int nr);
+    void removePiece(int square);
+
+    int squares[64];
+    bool whitetomove;
+    int castling;   //CASTLE_* bits
+    int epsquare;   //square a pawn can capture en passant on, NO_PIECE if there is none
+    int halfmoves;  //halfmoves since the last capture or pawn move, for the 50-move rule
+    std::vector<undoInfo> history;
+
+    uint64_t zobrist;
+    std::vector<uint16_t> movelist;
+    std::vector<uint64_t> keylist;
+    std::unordered_map<uint64_t, int> seen; //how often every key was on the board
+};
+
+#endif
@@ -0,0 +1,441 @@
+/* Helper functions of the detection: the board geometry, the pieces and their notation
+ * Author: SaltFactory (https://gitlab.com/Salt_Factory, https://github.com/Salt-Factory)
+ */
+
+#include <cmath>
+#include "chessdetection.h"
+
+/* Function that finds all the chessboardcorners and stores them in a vector
+ * this function might seem a bit redundant, but this is for in the case of future improvement to the algorithm
+ *  input: image containing a chessboard, a pointer to the destinationvector
+ *  output: void, and in pointlist the inner points on the chessboard
+ */
+void findAllChessboardCorners(Mat img, vector<Point2f>* pointlist)
+{
+    //first we use a basic opencv function (thank god!)
+    //this function however only returns the inner corners
+    findChessboardCorners(img, Size(7,7), *pointlist);
+    normalizeCorners(pointlist);
+}
+
+/* Function that puts the corners in reading order: rows from top to bottom, in every row from left to right
+ * on a square board findChessboardCorners can start in any corner, and the rest of the code expects the top left one first
+ *  input: pointer to the 49 inner corners
+ *  output: void
+ */
+void normalizeCorners(vector<Point2f>* corners)
+{
+    if (corners->size() != 49)
+    {
+        return;
+    }
+    vector<Point2f> old = *corners;
+    vector<Point2f> best;
+    float bestscore = -BIGNUMBER*BIGNUMBER;
+    //try the 8 ways to order a square grid: transposed or not, and rows and columns reversed or not
+    for (int s = 0; s < 8; s++)
+    {
+        vector<Point2f> ordered(49);
+        for (int r = 0; r < 7; r++)
+        {
+            for (int c = 0; c < 7; c++)
+            {
+                int r2 = (s & 1) ? c : r;
+                int c2 = (s & 1) ? r : c;
+                r2 = (s & 2) ? 6 - r2 : r2;
+                c2 = (s & 4) ? 6 - c2 : c2;
+                ordered[r*7 + c] = old[r2*7 + c2];
+            }
+        }
+        //a row should go to the right, a column down
+        float score = (ordered[6] - ordered[0]).x + (ordered[42] - ordered[0]).y;
+        if (score > bestscore)
+        {
+            bestscore = score;
+            best = ordered;
+        }
+    }
+    *corners = best;
+}
+
+/* Function that turns a position in the image (row 0 at the top, column 0 on the left) into a position on the board
+ * the orientation is how many quarter turns the board is turned from the standard view, which has
+ * white at the top of the image and the h-file on the left (so rows are ranks and columns mirrored files)
+ *  input: the position in the image, and the orientation (0 to 3)
+ *  output: the position on the board
+ */
+position orientPosition(position p, int orientation)
+{
+    if (p.row < 0 || p.column < 0)
+    {
+        return p;
+    }
+    position o = p;
+    switch (orientation)
+    {
+        case 1: o.row = p.column; o.column = 7 - p.row; break;
+        case 2: o.row = 7 - p.row; o.column = 7 - p.column; break;
+        case 3: o.row = 7 - p.column; o.column = p.row; break;
+    }
+    return o;
+}
+
+//the other way around: from a position on the board to the position in the image
+position unorientPosition(position p, int orientation)
+{
+    return orientPosition(p, (4 - orientation)%4);
+}
+
+/* Function that writes the geometry of the board to a file, so the next time it doesn't need to be calibrated
+ *  input: the path, the inner corners and the orientation
+ *  output: true if it was written
+ */
+bool saveGeometry(string path, const vector<Point2f>& cornerlist, int orientation)
+{
+    FileStorage fs(path, FileStorage::WRITE);
+    if (!fs.isOpened())
+    {
+        return false;
+    }
+    fs << "corners" << cornerlist;
+    fs << "orientation" << orientation;
+    fs.release();
+    return true;
+}
+
+/* Function that reads the geometry saveGeometry wrote
+ *  input: the path, and pointers to the corners and the orientation
+ *  output: true if the file was there and had a full board in it
+ */
+bool loadGeometry(string path, vector<Point2f>* cornerlist, int* orientation)
+{
+    FileStorage fs(path, FileStorage::READ);
+    if (!fs.isOpened())
+    {
+        return false;
+    }
+    fs["corners"] >> *cornerlist;
+    fs["orientation"] >> *orientation;
+    return cornerlist->size() == 49 && *orientation >= 0 && *orientation < 4;
+}
+
+//sadly not even the ugliest function I've ever written
+//initialises a vector of pieces
+void initPieceList(vector<piece> (*pieceList))
+{
+    //add in the white pawns
+    for (int i = 0; i < 8; i++)
+    {
+        piece pawn;
+        position pos;
+        pos.column = i;
+        pos.row = 1;
+
+        pawn.nr = PAWN_W;
+        pawn.pos = pos;
+        (*pieceList).push_back(pawn);
+    }
+
+    //add in the black pawns
+    for (int i = 0; i < 8; i++)
+    {
+        piece pawn;
+        position pos;
+        pos.column = i;
+        pos.row = 6;
+
+        pawn.nr = PAWN_B;
+        pawn.pos = pos;
+        (*pieceList).push_back(pawn);
+    }
+    
+    {
+        piece rook;
+        position pos;
+        pos.column = 0;
+        pos.row = 0;
+
+        rook.nr = ROOK_W;
+        rook.pos = pos;
+        (*pieceList).push_back(rook);
+
+        pos.column = 7;
+        rook.pos = pos;
+        (*pieceList).push_back(rook);
+
+        pos.row = 7;
+        rook.pos = pos;
+        rook.nr = ROOK_B;
+        (*pieceList).push_back(rook);
+
+        pos.column = 0;
+        rook.pos = pos;
+        (*pieceList).push_back(rook);
+
+    }
+    {
+        piece knight;
+        position pos;
+        pos.column = 1;
+        pos.row = 0;
+
+        knight.nr = KNIGHT_W;
+        knight.pos = pos;
+        (*pieceList).push_back(knight);
+
+        pos.column = 6;
+        knight.pos = pos;
+        (*pieceList).push_back(knight);
+
+        pos.row = 7;
+        knight.pos = pos;
+        knight.nr = KNIGHT_B;
+        (*pieceList).push_back(knight);
+
+        pos.column = 1;
+        knight.pos = pos;
+        (*pieceList).push_back(knight);
+
+    }
+    {
+        piece bish;
+        position pos;
+        pos.column = 2;
+        pos.row = 0;
+
+        bish.nr = BISH_W;
+        bish.pos = pos;
+        (*pieceList).push_back(bish);
+
+        pos.column = 5;
+        bish.pos = pos;
+        (*pieceList).push_back(bish);
+
+        pos.row = 7;
+        bish.pos = pos;
+        bish.nr = BISH_B;
+        (*pieceList).push_back(bish);
+
+        pos.column = 2;
+        bish.pos = pos;
+        (*pieceList).push_back(bish);
+
+    }
+    {
+        piece king;
+        position pos;
+        pos.column = 3;
+        pos.row = 0;
+
+        king.nr = KING_W;
+        king.pos = pos;
+        (*pieceList).push_back(king);
+
+        pos.row = 7;
+        king.pos = pos;
+        king.nr = KING_B;
+        (*pieceList).push_back(king);
+    }
+    {
+        piece queen;
+        position pos;
+        pos.column = 4;
+        pos.row = 0;
+
+        queen.nr = QUEEN_W;
+        queen.pos = pos;
+        (*pieceList).push_back(queen);
+
+        pos.row = 7;
+        queen.pos = pos;
+        queen.nr = QUEEN_B;
+        (*pieceList).push_back(queen);
+    }
+}
+
+/* Function to convert a pieceint to it's stringname
+ *  input: the number in int
+ *  output: the name of the piece belonging to that number
+ */
+string nrToString(int nr)
+{
+    switch(nr){
+        case PAWN_B: return "Black Pawn"; break;
+        case PAWN_W: return "White Pawn"; break;
+        case KING_B: return "Black King"; break;
+        case KING_W: return "White King"; break;
+        case BISH_B: return "Black Bishop"; break;
+        case BISH_W: return "White Bishop"; break;
+        case QUEEN_B: return "Black Queen"; break;
+        case QUEEN_W: return "White Queen"; break;
+        case KNIGHT_B: return "Black Knight"; break;
+        case KNIGHT_W: return "White Knight"; break;
+        case ROOK_B: return "Black Rook"; break;
+        case ROOK_W: return "White Rook"; break;
+    }
+    return "";
+
+}
+
+/* Function to convert the movement of a piece to the official Algebraic chess notation
+ *  input: the piece that moved, and a bool of whether it captured another piece
+ *  output: the notation of the move (eg "Nxe5")
+ */
+string moveToString(piece p, bool capture)
+{
+    vector<string> letterlist = {"a","b","c","d","e","f","g","h"};
+
+    string letter = "";
+    switch(p.nr){
+        case KING_W: letter = "K"; break;
+        case KING_B: letter = "K"; break;
+        case BISH_W: letter = "B"; break;
+        case BISH_B: letter = "B"; break;
+        case ROOK_W: letter = "R"; break;
+        case ROOK_B: letter = "R"; break;
+        case QUEEN_W: letter = "Q"; break;
+        case QUEEN_B: letter = "Q"; break;
+        case KNIGHT_W : letter = "N"; break;
+        case KNIGHT_B : letter = "N"; break;
+    }
+
+    string notation = letter;
+    if (capture)
+    {
+        notation += "x";
+    }
+    notation += letterlist[7-p.pos.column];
+    notation += to_string(p.pos.row + 1); //rows start at 0, ranks start at 1
+    return notation;
+}
+
+/* Function that finds the areas where something moved, on the mask of the backgroundsubtraction
+ *  input: the mask, the element it gets dilated with, and the vector to add the bounding rectangles of the areas to
+ *  output: void
+ */
+void movementAreas(const Mat& mask, const Mat& element, vector<Rect>* boundRectList)
+{
+    //first threshold the image on grayvalue 200, so that it becomes binary (with "0"="0" and "1"="255")
+    Mat img = mask > 200;
+
+    dilate(img,img,element); //dilate for when a piece leaves behind 2 holes instead of 1 hole on a tile, to increase the chance of them becoming one contour
+
+    //create empty vector of contours
+    vector <vector<Point>> contours;
+    //find the contours
+    findContours(img, contours, RETR_EXTERNAL, CHAIN_APPROX_NONE);
+
+    //find the bounding rectangles
+    for (int i = 0; i < contours.size(); i ++)
+    {
+        Rect boundRect = boundingRect(Mat(contours[i]));
+        (*boundRectList).push_back(boundRect);
+    }
+}
+
+position coordToPosition(int x, int y, vector<Point2f> cornerlist)
+{
+    for (int j = 0; j < cornerlist.size(); j++)
+    {
+        if (x < cornerlist[j].x && y < cornerlist[j].y)
+        {
+            position p;
+            p.column = j%7;
+            p.row = j/7;
+            return p;
+        }
+        if (j%7 == 6 && y < cornerlist[j].y && x > cornerlist[j].x)
+        {
+            position p;
+            p.column = 7;
+            p.row = j/7;
+            return p;
+        }
+        if (j > 41 && y > cornerlist[j].y && x < cornerlist[j].x)
+        {
+            position p;
+            p.column = j%7;
+            p.row = 7;
+            return p;
+        }
+        if (j == 48 && y > cornerlist[j].y && x > cornerlist[j].x)
+        {
+            position p;
+            p.column = 7;
+            p.row = 7;
+            return p;
+        }
+    }
+    position p;
+    p.column = -1;
+    p.row = -1;
+    return p;
+
+}
+
+/* Function that converts a position to the square the chess rules use
+ * columns run from the h-file to the a-file, which is also why moveToString uses 7-column
+ *  input: the position
+ *  output: the square (0 is a1, 63 is h8)
+ */
+int positionToSquare(position pos)
+{
+    return squareOf(pos.row, 7 - pos.column);
+}
+
+position squareToPosition(int square)
+{
+    position pos;
+    pos.row = rankOf(square);
+    pos.column = 7 - fileOf(square);
+    return pos;
+}
+
+/* Function that gives a corner of the grid of squares, also the outer ones findChessboardCorners doesn't find
+ * the outer corners are extrapolated from the inner corners next to them
+ *  input: row and column of the corner (-1 to 7, where 0 to 6 are the inner corners), and the inner corners
+ *  output: the corner
+ */
+static Point2f gridCorner(int row, int col, const vector<Point2f>& cornerlist)
+{
+    int r0 = min(max(row, 0), 5);
+    int c0 = min(max(col, 0), 5);
+    Point2f origin = cornerlist[r0*7 + c0];
+    Point2f colstep = cornerlist[r0*7 + c0 + 1] - origin;
+    Point2f rowstep = cornerlist[(r0 + 1)*7 + c0] - origin;
+    return origin + (float)(col - c0)*colstep + (float)(row - r0)*rowstep;
+}
+
+/* Function that gives the middle part of a square, away from its edges (where a piece on the next square can stick out)
+ *  input: the position of the square, the inner corners and which part of the square to keep (0.5 keeps the middle half)
+ *  output: the rectangle in the image
+ */
+Rect positionToRect(position pos, vector<Point2f> cornerlist, double part)
+{
+    //the square lies between the corners (row-1, col-1) and (row, col)
+    Point2f a = gridCorner(pos.row - 1, pos.column - 1, cornerlist);
+    Point2f b = gridCorner(pos.row, pos.column, cornerlist);
+    Point2f centre = (a + b)*0.5f;
+    float w = fabs(b.x - a.x)*part;
+    float h = fabs(b.y - a.y)*part;
+    return Rect(Point(centre.x - w/2, centre.y - h/2), Point(centre.x + w/2, centre.y + h/2));
+}
+
+void positionToCoord(position pos, int*x, int*y, vector<Point2f> cornerlist)
+{
+    (*x) = cornerlist[6].x + 10;
+    (*y) = cornerlist[42].y + 10;
+    for (int i = 0; i < 7; i++)
+    {
+        if (pos.column == i)
+        {
+            (*x) = cornerlist[i].x - 25;
+        }
+
+        if (pos.row == i)
+        {
+            (*y) = cornerlist[i*7].y - 25;
+        }
+    }
+
+}
@@ -1,9 +1,12 @@
+#ifndef CHESSDETECTION_H
+#define CHESSDETECTION_H
 
 #include <iostream>
 #include <fstream>
 #include <opencv2/opencv.hpp>
 #include <opencv2/videoio.hpp>
 #include <opencv2/highgui.hpp>
+#include "board.h"
 
 using namespace std;
 using namespace cv;
@@ -15,43 +18,44 @@ using namespace cv;
 #define IMG_H 450
 #define IMG_W 450
 #define THRESHOLD 50
+#define PIECE_CONTRAST 12 //greyvalues a piece changes the brightness of its square by, at least
+#define RECHECK_COUNT 8   //checks in a row that have to agree on the same explanation before the recognizer corrects itself
+#define RECHECK_TOLERANCE 1 //contradictions the corrected position may still have (a piece that has the colour of its square)
+
+#define GATE_SIZE 32          //size of the downsampled frame used by the motion gate
+#define GATE_THRESHOLD 12     //greyvalue difference a downsampled pixel needs before the gate opens
+#define GATE_HOLD 30          //amount of frames the gate stays open after the last change
+#define GATE_IDLE_INTERVAL 15 //when idle, only every n-th frame goes through the full pipeline
+#define GATE_BUSY_PIXELS 50   //foreground pixels (shadows not counted) the mask needs to keep the gate open, less is noise
 
-#define PAWN_B 0
-#define PAWN_W 1
-#define KING_B 2
-#define KING_W 3
-#define QUEEN_B 4
-#define QUEEN_W 5
-#define BISH_B 6
-#define BISH_W 7
-#define KNIGHT_B 8
-#define KNIGHT_W 9
-#define ROOK_B 10
-#define ROOK_W 11
 
 
 struct position
 {
     int row;
     int column;
-} Position;
+};
 
 struct piece
 {
     int nr;
     position pos;
-} Piece;
+};
 
-void drawPoints(vector<Point2f> pointslist, Mat img);
 void findAllChessboardCorners(Mat img, vector<Point2f>* pointlist);
-bool detectMovement(Mat img, vector<Rect>* boundRectList);
-void findMovement(vector<Rect> boundRectList, vector<Point2f> cornerlist);
-
+void normalizeCorners(vector<Point2f>* corners);
 void initPieceList(vector<piece>* pieceList);
 string nrToString(int nr);
-void toFile(piece p, bool capture);
-void findLegalMoves(piece p);
-bool findPieceOnPos(position p, piece* Piece);
+string moveToString(piece p, bool capture);
+void movementAreas(const Mat& mask, const Mat& element, vector<Rect>* boundRectList);
 position coordToPosition(int x, int y, vector<Point2f> cornerlist);
-void positionToCoord(position pos, int*x, int*y);
-void on_mouse(int e, int x, int y, int d, void *ptr);
+int positionToSquare(position pos);
+position squareToPosition(int square);
+void positionToCoord(position pos, int*x, int*y, vector<Point2f> cornerlist);
+Rect positionToRect(position pos, vector<Point2f> cornerlist, double part = 0.5);
+position orientPosition(position p, int orientation);
+position unorientPosition(position p, int orientation);
+bool saveGeometry(string path, const vector<Point2f>& cornerlist, int orientation);
+bool loadGeometry(string path, vector<Point2f>* cornerlist, int* orientation);
+
+#endif
@@ -0,0 +1,290 @@
+/* Sources the pipeline can read its frames from
+ */
+
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "framesource.h"
+
+double monotonicMs()
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CaptureSource::read(Mat& frame)
+{
+    if (!cap.read(frame))
+    {
+        return false;
+    }
+    if (!live)
+    {
+        stamp = cap.get(CAP_PROP_POS_MSEC);
+        return true;
+    }
+    //V4L2 gives the moment the driver got the frame, on the same monotonic clock, so the time the frame waited in the
+    //buffers counts in the lag too. Other backends give 0 or a time of their own, decided once so the stamps never jump
+    double now = monotonicMs();
+    double captured = cap.get(CAP_PROP_POS_MSEC);
+    if (stamp == 0)
+    {
+        backendstamps = captured > 0 && captured <= now && now - captured < CAPTURE_STAMP_WINDOW;
+    }
+    stamp = backendstamps && captured > 0 ? captured : now;
+    return true;
+}
+
+ImageSequenceSource::ImageSequenceSource(string directory, double fps) : next(0), rate(fps)
+{
+    glob(directory, files, false);
+    sort(files.begin(), files.end());
+}
+
+bool ImageSequenceSource::read(Mat& frame)
+{
+    while (next < files.size())
+    {
+        frame = imread(files[next++]);
+        if (!frame.empty())
+        {
+            return true;
+        }
+        //not an image (eg a textfile in the same directory), skip it
+    }
+    return false;
+}
+
+SharedMemorySource::SharedMemorySource(string name) : header(NULL), size(0), next(0), stamp(0)
+{
+    int fd = shm_open(name.c_str(), O_RDWR, 0); //read-write, for the consumed counter
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size >= SHM_RING_DATA)
+    {
+        size = info.st_size;
+        void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory != MAP_FAILED)
+        {
+            header = (shmRingHeader*)memory;
+        }
+    }
+    ::close(fd);
+    if (header == NULL)
+    {
+        return;
+    }
+
+    //the frames the header describes have to be inside the memory, or a bad header would make us read past it
+    bool valid = header->magic == SHM_RING_MAGIC && header->slots > 0 && header->slots <= SHM_RING_MAX_SLOTS
+              && header->width > 0 && header->height > 0 && header->type >= 0
+              && (uint64_t)header->step >= (uint64_t)header->width*CV_ELEM_SIZE(header->type)
+              && SHM_RING_DATA + (uint64_t)header->slots*header->step*header->height <= size;
+    if (!valid)
+    {
+        cerr << "Shared memory " << name << " isn't a frame ring (or doesn't fit the frames its header describes)" << endl;
+        munmap(header, size);
+        header = NULL;
+    }
+}
+
+SharedMemorySource::~SharedMemorySource()
+{
+    if (header != NULL)
+    {
+        munmap(header, size);
+    }
+}
+
+bool SharedMemorySource::read(Mat& frame)
+{
+    if (header == NULL)
+    {
+        return false;
+    }
+    //wait for the writer
+    while (header->written.load() <= next)
+    {
+        if (header->closed.load())
+        {
+            return false;
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    while (true)
+    {
+        //if we're too slow and the writer went around the ring, skip to the newest frame
+        uint64_t written = header->written.load();
+        if (written - next > header->slots - 1)
+        {
+            next = written - 1;
+        }
+        atomic<uint64_t>& sequence = header->sequence[next % header->slots];
+        uint64_t done = 2*next + 2; //the sequence number of the slot once frame next is in it
+        if (sequence.load() != done)
+        {
+            next = header->written.load() - 1; //the writer is already busy with this slot again
+            continue;
+        }
+        uint8_t* data = (uint8_t*)header + SHM_RING_DATA + (next % header->slots)*header->step*header->height;
+        Mat(header->height, header->width, header->type, data, header->step).copyTo(frame);
+        atomic_thread_fence(memory_order_acquire); //the copy has to be done before the sequence is checked again
+        if (sequence.load() != done)
+        {
+            continue; //torn, the writer came around while we copied it
+        }
+        break;
+    }
+    stamp = monotonicMs();
+    next++;
+    header->consumed.store(next);
+    return true;
+}
+
+SharedMemoryWriter::SharedMemoryWriter(string name, int slots, int width, int height, int type, bool wait) : name(name), header(NULL), size(0), wait(wait)
+{
+    if (slots <= 0 || slots > SHM_RING_MAX_SLOTS)
+    {
+        return;
+    }
+    size_t step = width*CV_ELEM_SIZE(type);
+    size = SHM_RING_DATA + slots*step*height;
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        return;
+    }
+    if (ftruncate(fd, size) == 0)
+    {
+        void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory != MAP_FAILED)
+        {
+            header = (shmRingHeader*)memory;
+            header->slots = slots;
+            header->width = width;
+            header->height = height;
+            header->type = type;
+            header->step = step;
+            header->written.store(0);
+            header->closed.store(0);
+            header->consumed.store(0);
+            for (int i = 0; i < SHM_RING_MAX_SLOTS; i++)
+            {
+                header->sequence[i].store(0);
+            }
+            header->magic = SHM_RING_MAGIC; //last, so readers don't see a half made header
+        }
+    }
+    ::close(fd);
+}
+
+SharedMemoryWriter::~SharedMemoryWriter()
+{
+    if (header != NULL)
+    {
+        close();
+        munmap(header, size);
+        shm_unlink(name.c_str());
+    }
+}
+
+void SharedMemoryWriter::write(const Mat& frame)
+{
+    if (header == NULL || frame.rows != header->height || frame.cols != header->width || frame.type() != header->type)
+    {
+        return;
+    }
+    uint64_t n = header->written.load();
+    while (wait && n - header->consumed.load() >= header->slots)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    atomic<uint64_t>& sequence = header->sequence[n % header->slots];
+    sequence.store(2*n + 1); //a reader that sees this (or sees it changed) knows the slot is being overwritten
+    atomic_thread_fence(memory_order_release); //before any pixel of the slot changes
+    uint8_t* data = (uint8_t*)header + SHM_RING_DATA + (n % header->slots)*header->step*header->height;
+    Mat slot(header->height, header->width, header->type, data, header->step);
+    frame.copyTo(slot);
+    sequence.store(2*n + 2);
+    header->written.store(n + 1);
+}
+
+void SharedMemoryWriter::close()
+{
+    if (header != NULL)
+    {
+        header->closed.store(1);
+    }
+}
+
+bool MemorySource::read(Mat& frame)
+{
+    unique_lock<mutex> guard(lock);
+    available.wait(guard, [this] { return !frames.empty() || closed; });
+    if (frames.empty())
+    {
+        return false;
+    }
+    frame = frames.front().first;
+    stamp = frames.front().second;
+    frames.pop_front();
+    return true;
+}
+
+void MemorySource::push(const Mat& frame, double timestamp)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        frames.push_back(make_pair(frame, timestamp < 0 ? monotonicMs() : timestamp)); //only the header is copied, the pixels are shared
+    }
+    available.notify_one();
+}
+
+void MemorySource::close()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        closed = true;
+    }
+    available.notify_all();
+}
+
+/* Function that opens a framesource from a short description
+ *  input: "cam:<index>", "video:<path>", "images:<directory>", "shm:<name>" or "synth:<pgn>",
+ *         a number on its own is a camera, anything else a video
+ *  output: the source, check isOpened() to see if it worked
+ */
+Ptr<FrameSource> openFrameSource(string spec)
+{
+    size_t colon = spec.find(':');
+    string kind = colon == string::npos ? "" : spec.substr(0, colon);
+    string arg = colon == string::npos ? spec : spec.substr(colon + 1);
+
+    if (kind == "cam" || (kind.empty() && !arg.empty() && all_of(arg.begin(), arg.end(), ::isdigit)))
+    {
+        return makePtr<CameraSource>(stoi(arg));
+    }
+    if (kind == "images")
+    {
+        return makePtr<ImageSequenceSource>(arg);
+    }
+    if (kind == "shm")
+    {
+        return makePtr<SharedMemorySource>(arg);
+    }
+    if (kind == "synth")
+    {
+        return makePtr<SynthSource>(synthConfig(), readPgnMoves(arg));
+    }
+    if (kind == "video")
+    {
+        return makePtr<VideoFileSource>(arg);
+    }
+    return makePtr<VideoFileSource>(spec);
+}
@@ -0,0 +1,173 @@
+/* Sources the pipeline can read its frames from
+ * every source gives frames through the same read(), so the pipeline doesn't care whether they come from
+ * a webcam, a video, a directory of images, another process or are made in this process
+ */
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "synthboard.h"
+
+class FrameSource
+{
+public:
+    virtual ~FrameSource() {}
+    virtual bool isOpened() const = 0;
+    virtual bool read(Mat& frame) = 0; //false when there are no more frames
+    virtual double fps() const { return 0; } //0 if the source doesn't know
+    virtual double timestamp() const = 0; //capture time of the last frame that was read, in milliseconds
+};
+
+double monotonicMs(); //milliseconds on a clock that never jumps, for sources that don't have timestamps of their own
+
+#define CAPTURE_STAMP_WINDOW 2000 //a capture time of the camera more than this many ms before the first read isn't on the monotonic clock
+
+//webcam or video, through the opencv videocapture
+//a video has the position of the frame in the file as timestamp, a webcam the moment the driver got the frame
+//(or the moment it was read, when the backend doesn't say)
+class CaptureSource : public FrameSource
+{
+public:
+    CaptureSource(bool live) : live(live), backendstamps(false), stamp(0) {}
+    bool isOpened() const { return cap.isOpened(); }
+    bool read(Mat& frame);
+    double fps() const { return cap.get(CAP_PROP_FPS); }
+    double timestamp() const { return stamp; }
+
+protected:
+    VideoCapture cap;
+    bool live;
+    bool backendstamps; //true if the camera gives its own capture times on the monotonic clock
+    double stamp;
+};
+
+class CameraSource : public CaptureSource
+{
+public:
+    CameraSource(int index) : CaptureSource(true) { cap.open(index); }
+};
+
+class VideoFileSource : public CaptureSource
+{
+public:
+    VideoFileSource(string path) : CaptureSource(false) { cap.open(path); }
+};
+
+//every image in a directory, in alphabetical order (so name them frame0001.png, frame0002.png, ...)
+class ImageSequenceSource : public FrameSource
+{
+public:
+    ImageSequenceSource(string directory, double fps = 30);
+    bool isOpened() const { return !files.empty(); }
+    bool read(Mat& frame);
+    double fps() const { return rate; }
+    double timestamp() const { return 1000.0*(next - 1)/rate; }
+
+private:
+    vector<string> files;
+    int next;
+    double rate;
+};
+
+/* Ring of frames in POSIX shared memory, filled by another process
+ * the memory starts with a shmRingHeader, followed by "slots" frames of height*step bytes,
+ * the first one starting at SHM_RING_DATA. Frame n is written in slot n%slots, after which "written" becomes n+1.
+ * Every slot has a sequence number: 2n+1 while frame n is being written in it, 2n+2 once it's done,
+ * so a reader can tell whether the slot changed under it. The reader sets "consumed" to the frames it has read,
+ * a writer that waits for the reader doesn't write further than "slots" frames ahead of it.
+ */
+#define SHM_RING_MAGIC 0x32534843 //"CHS2"
+#define SHM_RING_DATA 4096
+#define SHM_RING_MAX_SLOTS 256
+
+struct shmRingHeader
+{
+    uint32_t magic;
+    uint32_t slots;
+    int32_t width;
+    int32_t height;
+    int32_t type;       //opencv type of the frames, eg CV_8UC3
+    uint32_t step;      //bytes per row
+    std::atomic<uint64_t> written;  //amount of frames that were written
+    std::atomic<uint32_t> closed;   //set by the writer when there are no more frames
+    std::atomic<uint64_t> consumed; //amount of frames the reader has read
+    std::atomic<uint64_t> sequence[SHM_RING_MAX_SLOTS];
+};
+static_assert(sizeof(shmRingHeader) <= SHM_RING_DATA, "the header has to fit before the frames");
+
+class SharedMemorySource : public FrameSource
+{
+public:
+    SharedMemorySource(string name);
+    ~SharedMemorySource();
+    bool isOpened() const { return header != NULL; }
+    bool read(Mat& frame); //the frame is copied out of the ring (into frame's own memory when it fits), so the writer can't change it while the pipeline uses it
+    double timestamp() const { return stamp; } //the moment the frame was taken out of the ring
+
+private:
+    shmRingHeader* header;
+    size_t size;
+    uint64_t next;
+    double stamp;
+};
+
+//writer side of the ring, for producers that are written in C++
+class SharedMemoryWriter
+{
+public:
+    //with wait, write() blocks while the reader is a full ring behind, instead of overwriting frames it didn't read
+    SharedMemoryWriter(string name, int slots, int width, int height, int type, bool wait = false);
+    ~SharedMemoryWriter();
+    bool isOpened() const { return header != NULL; }
+    void write(const Mat& frame);
+    void close();
+
+private:
+    string name;
+    shmRingHeader* header;
+    size_t size;
+    bool wait;
+};
+
+//frames pushed by another thread of this process
+class MemorySource : public FrameSource
+{
+public:
+    MemorySource(double fps = 30) : closed(false), rate(fps), stamp(0) {}
+    bool isOpened() const { return true; }
+    bool read(Mat& frame); //waits for a frame
+    double fps() const { return rate; }
+    double timestamp() const { return stamp; }
+    void push(const Mat& frame, double timestamp = -1); //without a timestamp, the moment it was pushed is used
+    void close(); //read returns false once every pushed frame was read
+
+private:
+    std::mutex lock;
+    std::condition_variable available;
+    std::deque<std::pair<Mat, double>> frames;
+    bool closed;
+    double rate;
+    double stamp;
+};
+
+//frames drawn by the synthetic board
+class SynthSource : public FrameSource
+{
+public:
+    SynthSource(synthConfig config, vector<string> moves) : synth(config, moves) {}
+    bool isOpened() const { return true; }
+    bool read(Mat& frame) { return synth.nextFrame(frame); }
+    double fps() const { return synth.fps(); }
+    double timestamp() const { return 1000.0*(synth.frameIndex() - 1)/synth.fps(); }
+
+private:
+    SynthBoard synth;
+};
+
+Ptr<FrameSource> openFrameSource(string spec);
+
+#endif
@@ -0,0 +1,418 @@
+/* Binary archive of recorded games
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "gamearchive.h"
+
+using namespace std;
+
+//size of a game in the file: the header, the plies, and the padding up to 8 bytes
+static size_t gameSize(uint32_t plies)
+{
+    size_t bytes = sizeof(archiveGameHeader) + plies*(sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t));
+    return (bytes + 7)/8*8;
+}
+
+static bool positionLess(const archivePosition& a, const archivePosition& b)
+{
+    if (a.key != b.key) return a.key < b.key;
+    if (a.game != b.game) return a.game < b.game;
+    return a.ply < b.ply;
+}
+
+//copies a string in a fixed field, cut off so the zero at the end always fits
+static void copyField(char* field, size_t fieldsize, const string& value)
+{
+    memset(field, 0, fieldsize);
+    strncpy(field, value.c_str(), fieldsize - 1);
+}
+
+static string readField(const char* field, size_t fieldsize)
+{
+    return string(field, strnlen(field, fieldsize));
+}
+
+//the value of a tag pair line, eg [White "Carlsen"]
+static bool parseTag(const string& line, string* name, string* value)
+{
+    size_t space = line.find(' ');
+    size_t open = line.find('"');
+    size_t close = line.rfind('"');
+    if (line.empty() || line[0] != '[' || space == string::npos || open == string::npos || close <= open)
+    {
+        return false;
+    }
+    *name = line.substr(1, space - 1);
+    *value = line.substr(open + 1, close - open - 1);
+    return true;
+}
+
+bool gameFromPgn(string path, archivedGame* game)
+{
+    ifstream file(path);
+    if (!file.is_open())
+    {
+        cerr << "Cannot open pgn " << path << endl;
+        return false;
+    }
+    *game = archivedGame();
+    string line;
+    while (getline(file, line))
+    {
+        string name, value;
+        if (!parseTag(line, &name, &value))
+        {
+            continue;
+        }
+        if (name == "White") game->white = value;
+        else if (name == "Black") game->black = value;
+        else if (name == "Event") game->event = value;
+        else if (name == "Date") game->date = value;
+        else if (name == "Result") game->result = value;
+        else if (name == "FEN") game->fen = value;
+    }
+
+    Board board;
+    if (!game->fen.empty() && !board.setFen(game->fen))
+    {
+        cerr << "Bad starting position in " << path << endl;
+        return false;
+    }
+    vector<string> sanlist = readPgnMoves(path);
+    for (int i = 0; i < sanlist.size(); i++)
+    {
+        chessMove m;
+        if (!board.parseSan(sanlist[i], &m))
+        {
+            cerr << "Move " << i + 1 << " (" << sanlist[i] << ") of " << path << " isn't legal" << endl;
+            return false;
+        }
+        board.makeMove(m);
+        game->moves.push_back(encodeMove(m));
+        game->thinktimes.push_back(0);
+        game->confidences.push_back(100);
+    }
+    return true;
+}
+
+bool ArchiveWriter::add(const archivedGame& game)
+{
+    Board board;
+    if (!game.fen.empty() && !board.setFen(game.fen))
+    {
+        return false;
+    }
+    //the positions are only added when the whole game is legal
+    vector<archivePosition> reached;
+    uint32_t number = gamelist.size();
+    for (uint32_t ply = 0; ply < game.moves.size(); ply++)
+    {
+        chessMove m = decodeMove(game.moves[ply]);
+        if (!board.isLegal(m))
+        {
+            return false;
+        }
+        archivePosition p = {board.key(), number, ply};
+        reached.push_back(p);
+        board.makeMove(m);
+    }
+    archivePosition last = {board.key(), number, (uint32_t)game.moves.size()};
+    reached.push_back(last);
+
+    positions.insert(positions.end(), reached.begin(), reached.end());
+    gamelist.push_back(game);
+    //a game without times or confidences gets 0 ms and 100
+    gamelist.back().thinktimes.resize(game.moves.size(), 0);
+    gamelist.back().confidences.resize(game.moves.size(), 100);
+    return true;
+}
+
+ArchiveLock::ArchiveLock(string path)
+{
+    string lockpath = path + ".lock";
+    fd = ::open(lockpath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        cerr << "Cannot open " << lockpath << endl;
+        return;
+    }
+    if (flock(fd, LOCK_EX) != 0)
+    {
+        cerr << "Cannot lock " << lockpath << endl;
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+ArchiveLock::~ArchiveLock()
+{
+    if (fd >= 0)
+    {
+        ::close(fd); //closing it releases the lock
+    }
+}
+
+bool ArchiveWriter::write(string path) const
+{
+    archiveHeader header;
+    header.magic = ARCHIVE_MAGIC;
+    header.version = ARCHIVE_VERSION;
+    header.games = gamelist.size();
+    header.positions = positions.size();
+
+    vector<uint64_t> offsets;
+    uint64_t offset = sizeof(archiveHeader);
+    for (int i = 0; i < gamelist.size(); i++)
+    {
+        offsets.push_back(offset);
+        offset += gameSize(gamelist[i].moves.size());
+    }
+    header.gameindex = offset;
+    header.keyindex = offset + offsets.size()*sizeof(uint64_t);
+
+    vector<archivePosition> sorted = positions;
+    sort(sorted.begin(), sorted.end(), positionLess);
+
+    string temporary = path + ".tmp";
+    ofstream file(temporary, ios::binary | ios::trunc);
+    if (!file.is_open())
+    {
+        cerr << "Cannot write archive " << temporary << endl;
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+    for (int i = 0; i < gamelist.size(); i++)
+    {
+        const archivedGame& game = gamelist[i];
+        archiveGameHeader gameheader;
+        copyField(gameheader.white, sizeof(gameheader.white), game.white);
+        copyField(gameheader.black, sizeof(gameheader.black), game.black);
+        copyField(gameheader.event, sizeof(gameheader.event), game.event);
+        copyField(gameheader.date, sizeof(gameheader.date), game.date);
+        copyField(gameheader.result, sizeof(gameheader.result), game.result);
+        copyField(gameheader.fen, sizeof(gameheader.fen), game.fen);
+        gameheader.plies = game.moves.size();
+        gameheader.flags = 0;
+        gameheader.started = game.started;
+        file.write((const char*)&gameheader, sizeof(gameheader));
+
+        size_t plies = game.moves.size();
+        file.write((const char*)game.thinktimes.data(), plies*sizeof(uint32_t));
+        file.write((const char*)game.moves.data(), plies*sizeof(uint16_t));
+        file.write((const char*)game.confidences.data(), plies*sizeof(uint8_t));
+        size_t used = sizeof(archiveGameHeader) + plies*(sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint8_t));
+        static const char padding[8] = {0};
+        file.write(padding, gameSize(plies) - used);
+    }
+    file.write((const char*)offsets.data(), offsets.size()*sizeof(uint64_t));
+    file.write((const char*)sorted.data(), sorted.size()*sizeof(archivePosition));
+    file.close();
+    if (!file)
+    {
+        cerr << "Cannot write archive " << temporary << endl;
+        return false;
+    }
+    return rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool GameArchive::open(string path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(archiveHeader))
+    {
+        void* memory = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (memory != MAP_FAILED)
+        {
+            data = (const char*)memory;
+            size = info.st_size;
+            header = (const archiveHeader*)memory;
+        }
+    }
+    ::close(fd);
+    if (header == NULL)
+    {
+        return false;
+    }
+
+    //everything the indexes point at has to be inside the file, so the rest doesn't have to check
+    bool valid = header->magic == ARCHIVE_MAGIC && header->version >= 1 && header->version <= ARCHIVE_VERSION
+              && header->gameindex <= size && (size - header->gameindex)/sizeof(uint64_t) >= header->games
+              && header->keyindex <= size && (size - header->keyindex)/sizeof(archivePosition) >= header->positions;
+    for (uint32_t i = 0; valid && i < header->games; i++)
+    {
+        uint64_t offset = ((const uint64_t*)(data + header->gameindex))[i];
+        valid = offset % 8 == 0 && offset + sizeof(archiveGameHeader) <= size
+             && offset + gameSize(((const archiveGameHeader*)(data + offset))->plies) <= size;
+    }
+    if (!valid)
+    {
+        cerr << path << " isn't a game archive (or not one of this version)" << endl;
+        close();
+        return false;
+    }
+    if (header->version < ARCHIVE_VERSION)
+    {//the games are the same, only the keys of positions after a double step that can't be taken en passant changed
+        cerr << path << " has the position keys of version " << header->version << ", find can miss positions right after a double step until a game is added" << endl;
+    }
+    return true;
+}
+
+void GameArchive::close()
+{
+    if (data != NULL)
+    {
+        munmap((void*)data, size);
+    }
+    data = NULL;
+    size = 0;
+    header = NULL;
+}
+
+const archiveGameHeader& GameArchive::gameHeader(int game) const
+{
+    uint64_t offset = ((const uint64_t*)(data + header->gameindex))[game];
+    return *(const archiveGameHeader*)(data + offset);
+}
+
+const uint32_t* GameArchive::thinktimes(int game) const
+{
+    return (const uint32_t*)(&gameHeader(game) + 1);
+}
+
+const uint16_t* GameArchive::moves(int game) const
+{
+    return (const uint16_t*)(thinktimes(game) + gameHeader(game).plies);
+}
+
+const uint8_t* GameArchive::confidences(int game) const
+{
+    return (const uint8_t*)(moves(game) + gameHeader(game).plies);
+}
+
+archivedGame GameArchive::game(int game) const
+{
+    const archiveGameHeader& h = gameHeader(game);
+    archivedGame g;
+    g.white = readField(h.white, sizeof(h.white));
+    g.black = readField(h.black, sizeof(h.black));
+    g.event = readField(h.event, sizeof(h.event));
+    g.date = readField(h.date, sizeof(h.date));
+    g.result = readField(h.result, sizeof(h.result));
+    g.fen = readField(h.fen, sizeof(h.fen));
+    g.started = h.started;
+    g.moves.assign(moves(game), moves(game) + h.plies);
+    g.thinktimes.assign(thinktimes(game), thinktimes(game) + h.plies);
+    g.confidences.assign(confidences(game), confidences(game) + h.plies);
+    return g;
+}
+
+vector<archivePosition> GameArchive::find(uint64_t key) const
+{
+    const archivePosition* first = (const archivePosition*)(data + header->keyindex);
+    const archivePosition* last = first + header->positions;
+    archivePosition low = {key, 0, 0};
+    const archivePosition* found = lower_bound(first, last, low, positionLess);
+    vector<archivePosition> result;
+    for (; found != last && found->key == key; found++)
+    {
+        result.push_back(*found);
+    }
+    return result;
+}
+
+string GameArchive::toPgn(int number) const
+{
+    archivedGame g = game(number);
+    ostringstream pgn;
+    pgn << "[Event \"" << (g.event.empty() ? "?" : g.event) << "\"]\n";
+    pgn << "[Date \"" << (g.date.empty() ? "????.??.??" : g.date) << "\"]\n";
+    pgn << "[White \"" << (g.white.empty() ? "?" : g.white) << "\"]\n";
+    pgn << "[Black \"" << (g.black.empty() ? "?" : g.black) << "\"]\n";
+    pgn << "[Result \"" << g.result << "\"]\n";
+    Board board;
+    int firstmove = 1;
+    if (!g.fen.empty())
+    {
+        pgn << "[SetUp \"1\"]\n[FEN \"" << g.fen << "\"]\n";
+        board.setFen(g.fen);
+        istringstream fields(g.fen);
+        string field;
+        for (int i = 0; i < 6 && fields >> field; i++)
+        {
+            if (i == 5)
+            {
+                firstmove = max(1, atoi(field.c_str())); //the number of the move the fen is on
+            }
+        }
+    }
+    pgn << "\n";
+
+    bool blackfirst = !board.whiteToMove();
+
+    //the movetext, with the time every move took and how sure the recognizer was when it wasn't sure
+    string text;
+    for (int ply = 0; ply < g.moves.size(); ply++)
+    {
+        string token;
+        int movenumber = firstmove + (ply + (blackfirst ? 1 : 0))/2;
+        if (board.whiteToMove())
+        {
+            token = to_string(movenumber) + ". ";
+        }
+        else if (ply == 0)
+        {
+            token = to_string(movenumber) + "... ";
+        }
+        chessMove m = decodeMove(g.moves[ply]);
+        token += board.toSan(m);
+        board.makeMove(m);
+        if (g.thinktimes[ply] > 0 || g.confidences[ply] < 100)
+        {
+            token += " {";
+            if (g.thinktimes[ply] > 0)
+            {
+                token += "[%emt " + clockToString(g.thinktimes[ply], true) + "]";
+            }
+            if (g.confidences[ply] < 100)
+            {
+                token += string(g.thinktimes[ply] > 0 ? " " : "") + "confidence " + to_string(g.confidences[ply]) + "%";
+            }
+            token += "}";
+        }
+        text += token + " ";
+    }
+    text += g.result;
+
+    //lines of at most 80 characters
+    istringstream words(text);
+    string word;
+    string line;
+    while (words >> word)
+    {
+        if (!line.empty() && line.size() + 1 + word.size() > 80)
+        {
+            pgn << line << "\n";
+            line.clear();
+        }
+        line += (line.empty() ? "" : " ") + word;
+    }
+    pgn << line << "\n";
+    return pgn.str();
+}
@@ -0,0 +1,144 @@
+/* Binary archive of recorded games
+ * every ply is a 16-bit move (see encodeMove), with the time it took and how sure the recognizer was of it.
+ * Behind the games there's an index of where every game starts, and an index of every position (by zobrist key)
+ * sorted on the key, so "every game that reached this position" is a binary search in a file that's mapped in memory.
+ *
+ * Layout of the file (in the byte order of the machine that wrote it, the magic tells if that's the wrong one):
+ *   archiveHeader
+ *   per game: archiveGameHeader, uint32_t thinktimes[plies], uint16_t moves[plies], uint8_t confidences[plies],
+ *             padded to a multiple of 8 bytes (biggest first, so every array is aligned)
+ *   uint64_t offsets[games]         where every game starts, from the start of the file
+ *   archivePosition positions[positions]   sorted on key, then game, then ply
+ */
+#ifndef GAMEARCHIVE_H
+#define GAMEARCHIVE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "board.h"
+
+#define ARCHIVE_MAGIC 0x31414743 //"CGA1"
+#define ARCHIVE_VERSION 2 //1 had the en passant file in every key after a double step, its games are still read (and keyed again when written)
+
+struct archiveHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t games;
+    uint32_t positions;
+    uint64_t gameindex;  //offset of the offsets of the games
+    uint64_t keyindex;   //offset of the positions
+};
+
+//the strings are zero-terminated, and cut off when they don't fit
+struct archiveGameHeader
+{
+    char white[32];
+    char black[32];
+    char event[48];
+    char date[16];      //as in a pgn, eg "2026.10.18"
+    char result[8];     //"1-0", "0-1", "1/2-1/2" or "*"
+    char fen[96];       //the starting position, empty for the normal one
+    uint32_t plies;
+    uint32_t flags;     //nothing yet
+    int64_t started;    //ms since the epoch the game started at, 0 if it isn't known
+};
+
+//a position that was on the board in a game: before the move of that ply, or after the last move when ply == plies
+struct archivePosition
+{
+    uint64_t key;
+    uint32_t game;
+    uint32_t ply;
+};
+
+//a game as it goes in or comes out of the archive
+struct archivedGame
+{
+    std::string white;
+    std::string black;
+    std::string event;
+    std::string date;
+    std::string result;
+    std::string fen;
+    int64_t started;
+    std::vector<uint16_t> moves;
+    std::vector<uint32_t> thinktimes;  //ms
+    std::vector<uint8_t> confidences;  //0-100
+
+    archivedGame() : result("*"), started(0) {}
+};
+
+/* Function that reads a game from a pgn: the tags and the moves, without times (they're 0) and with a confidence of 100
+ *  input: the path of the pgn, and the game to fill in
+ *  output: false if the pgn couldn't be read or has a move that isn't legal
+ */
+bool gameFromPgn(std::string path, archivedGame* game);
+
+//collects games, and writes them with both indexes in one go
+class ArchiveWriter
+{
+public:
+    bool add(const archivedGame& game); //false if a move isn't legal in the position of the game
+    int games() const { return gamelist.size(); }
+    bool write(std::string path) const; //written next to the file first, so a reader never sees half an archive
+
+private:
+    std::vector<archivedGame> gamelist;
+    std::vector<archivePosition> positions;
+};
+
+//an exclusive lock on an archive for as long as it exists, to hold around reading the games and writing them again with one more
+//(otherwise two processes that add a game at the same time both write what they read, and one of the games is lost)
+//the lock is an flock on "<archive>.lock", the archive itself is replaced on every write so it can't hold a lock
+class ArchiveLock
+{
+public:
+    ArchiveLock(std::string path); //waits until the lock is free
+    ~ArchiveLock();
+    bool isLocked() const { return fd >= 0; }
+
+private:
+    ArchiveLock(const ArchiveLock&);
+    ArchiveLock& operator=(const ArchiveLock&);
+
+    int fd;
+};
+
+//reads an archive through mmap, nothing is copied until a game is asked for
+class GameArchive
+{
+public:
+    GameArchive() : data(NULL), size(0), header(NULL) {}
+    ~GameArchive() { close(); }
+    bool open(std::string path);
+    void close();
+    bool isOpened() const { return header != NULL; }
+
+    int games() const { return header->games; }
+    const archiveGameHeader& gameHeader(int game) const;
+    const uint16_t* moves(int game) const;
+    const uint32_t* thinktimes(int game) const;
+    const uint8_t* confidences(int game) const;
+    archivedGame game(int game) const;
+
+    /* Function that finds every game that reached a position
+     *  input: the zobrist key of the position (Board::key)
+     *  output: the games and the ply it was on the board, sorted on game
+     */
+    std::vector<archivePosition> find(uint64_t key) const;
+
+    std::string toPgn(int game) const;
+
+private:
+    GameArchive(const GameArchive&);
+    GameArchive& operator=(const GameArchive&);
+
+    const char* data;
+    size_t size;
+    const archiveHeader* header;
+};
+
+#endif
@@ -0,0 +1,140 @@
+/* Compensation of slow changes in the lighting
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "lighting.h"
+
+void LightingCompensator::reset()
+{
+    for (int i = 0; i < 64; i++)
+    {
+        references[i] = 0;
+        hasreference[i] = false;
+    }
+    g = 1;
+    o = 0;
+}
+
+/* Function that fits seen = gain*reference + offset with least squares
+ * when the references are all about as bright (eg only light squares), only a gain is fitted
+ *  input: the pairs, and pointers to the gain and offset
+ *  output: false if the fit is worthless
+ */
+static bool fitGainOffset(const vector<double>& ref, const vector<double>& seen, double* gain, double* offset)
+{
+    double n = ref.size();
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (int i = 0; i < ref.size(); i++)
+    {
+        sx += ref[i];
+        sy += seen[i];
+        sxx += ref[i]*ref[i];
+        sxy += ref[i]*seen[i];
+    }
+    double variance = n*sxx - sx*sx;
+    if (variance > n*n*100) //the references are at least 10 greyvalues apart
+    {
+        *gain = (n*sxy - sx*sy)/variance;
+        *offset = (sy - *gain*sx)/n;
+    }
+    else if (sx > 0)
+    {
+        *gain = sy/sx;
+        *offset = 0;
+    }
+    else
+    {
+        return false;
+    }
+    return *gain > 0.25 && *gain < 4;
+}
+
+void LightingCompensator::update(const Mat& frame, const vector<Rect>& squares, const vector<bool>& empty)
+{
+    if (squares.size() != 64 || empty.size() != 64)
+    {
+        return;
+    }
+    Rect inside(0, 0, frame.cols, frame.rows);
+    double brightness[64];
+    bool measured[64];
+    vector<int> used;
+    vector<double> ref;
+    vector<double> seen;
+    for (int i = 0; i < 64; i++)
+    {
+        measured[i] = false;
+        if (!empty[i])
+        {//a piece stands on it, when it leaves the square gets a new reference
+            hasreference[i] = false;
+            continue;
+        }
+        Rect r = squares[i] & inside;
+        if (r.area() == 0)
+        {
+            continue;
+        }
+        Scalar m = mean(frame(r));
+        brightness[i] = (m[0] + m[1] + m[2] + m[3])/frame.channels();
+        measured[i] = true;
+        if (hasreference[i])
+        {
+            used.push_back(i);
+            ref.push_back(references[i]);
+            seen.push_back(brightness[i]);
+        }
+    }
+
+    if (used.size() >= LIGHT_MIN_SQUARES)
+    {
+        double gain, offset;
+        if (fitGainOffset(ref, seen, &gain, &offset))
+        {
+            //squares that don't follow the fit (a shadow, a piece the board doesn't know about) get left out, and it's fitted again
+            vector<double> residuals;
+            for (int i = 0; i < ref.size(); i++)
+            {
+                residuals.push_back(fabs(seen[i] - gain*ref[i] - offset));
+            }
+            vector<double> sorted = residuals;
+            nth_element(sorted.begin(), sorted.begin() + sorted.size()/2, sorted.end());
+            double limit = max(3*sorted[sorted.size()/2], 2.0);
+            vector<double> goodref, goodseen;
+            for (int i = 0; i < ref.size(); i++)
+            {
+                if (residuals[i] <= limit)
+                {
+                    goodref.push_back(ref[i]);
+                    goodseen.push_back(seen[i]);
+                }
+            }
+            if (goodref.size() >= LIGHT_MIN_SQUARES && fitGainOffset(goodref, goodseen, &gain, &offset))
+            {
+                //the light changes slowly, so one fit doesn't get to decide everything
+                g += LIGHT_SMOOTHING*(gain - g);
+                o += LIGHT_SMOOTHING*(offset - o);
+            }
+        }
+    }
+
+    //squares that are empty but don't have a reference yet get one, in the lighting of the references
+    for (int i = 0; i < 64; i++)
+    {
+        if (measured[i] && !hasreference[i])
+        {
+            references[i] = (brightness[i] - o)/g;
+            hasreference[i] = true;
+        }
+    }
+}
+
+bool LightingCompensator::correct(const Mat& frame, Mat& out) const
+{
+    if (fabs(g - 1) < LIGHT_TOLERANCE && fabs(o) < LIGHT_TOLERANCE*100)
+    {
+        return false;
+    }
+    frame.convertTo(out, -1, 1/g, -o/g);
+    return true;
+}
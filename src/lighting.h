@@ -0,0 +1,45 @@
+/* Compensation of slow changes in the lighting
+ * the squares that are empty look the same all game, so when they get brighter or darker it's the light that changed.
+ * A gain and offset is fitted between what the empty squares look like now and what they looked like before,
+ * and every frame is corrected with it before it goes to the background model.
+ */
+#ifndef LIGHTING_H
+#define LIGHTING_H
+
+#include "chessdetection.h"
+
+#define LIGHT_MIN_SQUARES 6     //amount of empty squares with a reference that are needed for a fit
+#define LIGHT_SMOOTHING 0.3     //how much a new fit counts, against the previous one
+#define LIGHT_TOLERANCE 0.01    //a correction smaller than this (in gain, and in greyvalues/100 for the offset) isn't applied
+
+class LightingCompensator
+{
+public:
+    LightingCompensator() { reset(); }
+    void reset(); //forget the references, back to no correction
+
+    /* Function that fits the gain and offset on the empty squares of a frame
+     * only call it when nothing is moving, a hand above an empty square would count as a change in the light
+     *  input: the frame, the rectangle of every square (indexed a1=0 .. h8=63), and which squares are empty
+     *  output: void
+     */
+    void update(const Mat& frame, const vector<Rect>& squares, const vector<bool>& empty);
+
+    /* Function that corrects a frame, so it has the lighting of the references
+     *  input: the frame, and the mat to write the corrected frame in
+     *  output: true if it was corrected, false if the correction was too small to bother (out isn't touched then)
+     */
+    bool correct(const Mat& frame, Mat& out) const;
+
+    bool reference(int square, double* value) const { *value = references[square]; return hasreference[square]; }
+    double gain() const { return g; }
+    double offset() const { return o; }
+
+private:
+    double references[64]; //brightness of every square when it was empty, in the lighting of the references
+    bool hasreference[64];
+    double g;
+    double o;
+};
+
+#endif
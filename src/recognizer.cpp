@@ -0,0 +1,896 @@
+/* The recognizer: turns a stream of frames of a chess board into moves
+ * Author: SaltFactory (https://gitlab.com/Salt_Factory, https://github.com/Salt-Factory)
+ */
+
+#include <cmath>
+#include <sstream>
+#include "recognizer.h"
+
+Recognizer::Recognizer()
+{
+    movementthreshold = THRESHOLD;
+    orient = 0;
+    orientationpending = false;
+    emptyknown = false;
+    timebase = 0;
+    timeincrement = 0;
+    //create an element for the erosion, and one for the dilation in detectMovement
+    erodeelement = getStructuringElement( MORPH_RECT, Size(5,5), Point(2,2));
+    dilateelement = getStructuringElement(MORPH_RECT, Size(13,13), Point(6,6));
+    reset();
+}
+
+/* Function that resets the state of the game, so a new game can be tracked
+ *  input: void
+ *  output: void
+ */
+void Recognizer::reset()
+{
+    //create a backgroundsubtractor
+    bgdet = makePtr<TiledBackground>();
+    fgmask.release();
+    light.reset();
+    processed = false;
+
+    movcount = 0;
+    turn = false;
+    pieceList.clear();
+    initPieceList(&pieceList);
+    moveLog.clear();
+    undone.clear();
+    contradictions = 0;
+    game.reset();
+    framecount = 0;
+    movstart = 0;
+    speculated = false;
+    framestamp = 0;
+    movstarttime = 0;
+    lastmovetime = 0;
+    startstamp = 0;
+    startseen = false;
+    clocks[0] = clocks[1] = timebase;
+    framelag = 0;
+
+    gateprev.release();
+    gatehold = 0;
+    gateidle = 0;
+    fgbusy = false;
+
+    analysedkey = game.key();
+    if (analyzer)
+    {
+        analyzer->analyse(game);
+    }
+}
+
+void Recognizer::setCorners(const vector<Point2f>& corners)
+{
+    cornerlist = corners;
+    imagerects.clear();
+    if (cornerlist.size() == 49)
+    {
+        for (int i = 0; i < 64; i++)
+        {
+            position p;
+            p.row = i/8;
+            p.column = i%8;
+            imagerects.push_back(positionToRect(p, cornerlist));
+        }
+    }
+    updateSquareRects();
+}
+
+void Recognizer::updateSquareRects()
+{
+    squarerects.clear();
+    if (imagerects.empty())
+    {
+        return;
+    }
+    for (int square = 0; square < 64; square++)
+    {
+        position p = unorientPosition(squareToPosition(square), orient);
+        squarerects.push_back(imagerects[p.row*8 + p.column]);
+    }
+}
+
+void Recognizer::setOrientation(int quarterturns)
+{
+    orient = quarterturns%4;
+    orientationpending = false;
+    updateSquareRects();
+    light.reset(); //the references belong to other squares now
+}
+
+position Recognizer::positionAt(int x, int y) const
+{
+    return orientPosition(coordToPosition(x, y, cornerlist), orient);
+}
+
+Point Recognizer::squareCentre(position p) const
+{
+    if (imagerects.empty() || p.row < 0 || p.row > 7 || p.column < 0 || p.column > 7)
+    {
+        return Point(-1, -1);
+    }
+    position i = unorientPosition(p, orient);
+    Rect r = imagerects[i.row*8 + i.column];
+    return Point(r.x + r.width/2, r.y + r.height/2);
+}
+
+static double squareBrightness(const Mat& frame, Rect r)
+{
+    r = r & Rect(0, 0, frame.cols, frame.rows);
+    if (r.area() == 0)
+    {
+        return 0;
+    }
+    Scalar m = mean(frame(r));
+    return (m[0] + m[1] + m[2] + m[3])/frame.channels();
+}
+
+void Recognizer::calibrateEmptyBoard(const Mat& frame)
+{
+    if (imagerects.empty())
+    {
+        return;
+    }
+    //the squares with an even row+column in the image all have the same colour, and the others the other colour
+    double parity[2] = {0, 0};
+    for (int i = 0; i < 64; i++)
+    {
+        emptybrightness[i] = squareBrightness(frame, imagerects[i]);
+        parity[(i/8 + i%8)%2] += emptybrightness[i];
+    }
+    emptyknown = true;
+    //a1 is dark: in the standard view it's on row 0, column 7 (odd), a quarter turn moves it to an even square
+    int darkparity = parity[0] < parity[1] ? 0 : 1;
+    setOrientation(darkparity == 1 ? 0 : 1);
+    orientationpending = true; //it could still be a half turn further, the pieces will tell
+}
+
+/* Function that decides on which side white sits, once both sides have their pieces
+ * the orientation is already right up to a half turn, so it's either the side of rank 1 and 2 or the opposite one
+ *  input: a frame on which nothing is moving
+ *  output: void
+ */
+void Recognizer::detectSide(const Mat& frame)
+{
+    double change[2] = {0, 0}; //how much brighter the two rows of white (0) and of black (1) got since the board was empty
+    int occupied[2] = {0, 0};
+    for (int square = 0; square < 64; square++)
+    {
+        int side = rankOf(square) < 2 ? 0 : (rankOf(square) > 5 ? 1 : -1);
+        if (side < 0)
+        {
+            continue;
+        }
+        position p = unorientPosition(squareToPosition(square), orient);
+        int i = p.row*8 + p.column;
+        double diff = squareBrightness(frame, imagerects[i]) - emptybrightness[i];
+        change[side] += diff;
+        if (fabs(diff) > PIECE_CONTRAST)
+        {
+            occupied[side]++;
+        }
+    }
+    //wait until (most of) the pieces are on both sides
+    if (occupied[0] < 12 || occupied[1] < 12)
+    {
+        return;
+    }
+    //white pieces make their squares brighter than black pieces do
+    setOrientation(change[0] >= change[1] ? orient : orient + 2);
+}
+
+void Recognizer::setTimeControl(double basems, double incrementms)
+{
+    timebase = basems;
+    timeincrement = incrementms;
+    clocks[0] = clocks[1] = timebase;
+}
+
+void Recognizer::setAnalyzer(Ptr<Analyzer> a)
+{
+    analyzer = a;
+    analysedkey = game.key();
+    if (analyzer)
+    {
+        analyzer->analyse(game);
+    }
+}
+
+vector<moveEvent> Recognizer::pushFrame(const Mat& frame, double timestamp)
+{
+    vector<moveEvent> events;
+    framecount++;
+    framestamp = timestamp;
+
+    //the lag is how much further the clock went than the timestamps since the first frame
+    //(when the source is a video that's read faster than realtime, it's negative)
+    if (framecount == 1)
+    {
+        firststamp = timestamp;
+        firsttick = getTickCount();
+        startstamp = timestamp; //until the starting position is seen on the board
+        lastmovetime = timestamp;
+    }
+    framelag = 1000.0*(getTickCount() - firsttick)/getTickFrequency() - (timestamp - firststamp);
+
+    //only run the expensive part of the pipeline when something on the board changed
+    //(or when we're still counting a move), a static board only gets a pass every few frames
+    processed = motionGate(frame) || fgmask.empty();
+    if (!processed)
+    {
+        //the board is idle, a good moment to work out what the next move can be
+        if (!speculated)
+        {
+            speculate();
+        }
+        return events;
+    }
+
+    //when nothing is moving, the empty squares tell how much the light changed since they were seen first
+    if (!squarerects.empty() && gatehold == 0 && movcount == 0)
+    {
+        if (orientationpending)
+        {
+            detectSide(frame);
+        }
+        vector<bool> empty(64);
+        for (int square = 0; square < 64; square++)
+        {
+            empty[square] = game.at(square) == NO_PIECE;
+        }
+        light.update(frame, squarerects, empty);
+
+        //the board should look like the position, if it doesn't a move was registered wrong (or not at all)
+        moveEvent fix;
+        if (!orientationpending && checkPosition(frame, &fix))
+        {
+            events.push_back(fix);
+        }
+    }
+    const Mat& input = light.correct(frame, corrected) ? corrected : frame; //so the background model doesn't see the light change
+
+    bgdet->apply(input, fgmask); //apply the foregroundmask on the image
+    erode(fgmask, fgmask, erodeelement); //erode the mask, to reduce the noise
+    fgbusy = countNonZero(fgmask > 200) > GATE_BUSY_PIXELS; //the background hasn't caught up with the board yet (MOG2 marks shadows with 127)
+
+    vector<Rect> boundRectList; //make an empty vector of bounding rectangles
+    moveEvent event;
+    bool moved = detectMovement(fgmask, &boundRectList);
+    if (moved && findMovement(boundRectList, &event) && game.isLegal(event.m)) //if we detect movement, we then need to find the movement (aka find out what moved to where)
+    {
+        event.frame = framecount;
+        event.latency = framecount - movstart;
+        event.timestamp = timestamp;
+        event.released = movstarttime;
+        event.thinktime = movstarttime - lastmovetime;
+        event.lag = framelag;
+        lastmovetime = movstarttime;
+        chargeClock(&event);
+        event.correction = false;
+
+        commit(&event);
+        undone.clear(); //a new move, so what was taken back can't be played again
+        events.push_back(event);
+    }
+    else if (moved)
+    {
+        //nothing (legal) could be made of it: the board stays as it is, and so does whose turn it is
+        //(if a move was missed after all, checkPosition finds it once the board keeps contradicting the position)
+        syncPieces();
+    }
+    return events;
+}
+
+/* Function that plays a move on the board and registers it
+ *  input: the event of the move, with the move and the timing filled in
+ *  output: false (and nothing changed) if the move isn't legal in the current position, the rest of the event filled in otherwise
+ */
+bool Recognizer::commit(moveEvent* event)
+{
+    if (!game.isLegal((*event).m))
+    {
+        return false; //makeMove doesn't check anything, a move from an empty square would break the board
+    }
+
+    //whatever the analyzer found on the position before the move, it doesn't get any further than this
+    (*event).analysed = analyzer && analyzer->latest(&(*event).analysis) && (*event).analysis.key == game.key();
+
+    (*event).ply = moveLog.size();
+    game.makeMove((*event).m);
+    (*event).key = game.key();
+    (*event).repetitions = game.repetitions();
+    (*event).fiftymoves = game.fiftyMoves();
+    moveLog.push_back(*event);
+    syncPieces(); //the piecelist follows the board, the rook of a castling move and the pawn taken en passant included
+    return true;
+}
+
+/* Function that takes the thinktime of a new move off the clock of the mover, and adds the increment
+ *  input: the event of the move, with the thinktime filled in
+ *  output: void, and the clock of the event filled in (-1 without a time control)
+ */
+void Recognizer::chargeClock(moveEvent* event)
+{
+    (*event).charged = timebase > 0;
+    (*event).clock = -1;
+    if ((*event).charged)
+    {
+        double& clock = clocks[(*event).white ? 0 : 1];
+        clock += timeincrement - (*event).thinktime;
+        (*event).clock = clock;
+    }
+}
+
+/* Function that works the clocks out again from the moves on the log, after moves were taken back, played again or replaced
+ * only the moves that were charged count, so what was never taken off a clock is never given back either
+ *  input: void
+ *  output: void, and the clock of every move on the log filled in again
+ */
+void Recognizer::recomputeClocks()
+{
+    clocks[0] = clocks[1] = timebase;
+    for (int i = 0; i < moveLog.size(); i++)
+    {
+        moveLog[i].clock = -1;
+        if (moveLog[i].charged)
+        {
+            double& clock = clocks[moveLog[i].white ? 0 : 1];
+            clock += timeincrement - moveLog[i].thinktime;
+            moveLog[i].clock = clock;
+        }
+    }
+}
+
+/* Function that fills in what a move does: the piece that moves, the piece that gets taken and the notation
+ *  input: the move (in the current position), and a pointer to the event to fill in
+ *  output: void
+ */
+void Recognizer::describeMove(chessMove m, moveEvent* event)
+{
+    int nr = game.at(m.from);
+    int taken = m.to;
+    if ((nr == PAWN_W || nr == PAWN_B) && fileOf(m.from) != fileOf(m.to) && game.at(m.to) == NO_PIECE)
+    {//en passant
+        taken = squareOf(rankOf(m.from), fileOf(m.to));
+    }
+    (*event).m = m;
+    (*event).white = isWhite(nr);
+    (*event).from = squareToPosition(m.from);
+    (*event).moved.nr = m.promotion != NO_PIECE ? m.promotion : nr;
+    (*event).moved.pos = squareToPosition(m.to);
+    (*event).capture = game.at(taken) != NO_PIECE;
+    (*event).captured.nr = game.at(taken);
+    (*event).captured.pos = squareToPosition(taken);
+    (*event).notation = moveToString((*event).moved, (*event).capture);
+    (*event).san = game.isLegal(m) ? game.toSan(m) : "";
+}
+
+//rebuilds the piecelist from the board, after every change of the board
+void Recognizer::syncPieces()
+{
+    pieceList.clear();
+    for (int square = 0; square < 64; square++)
+    {
+        if (game.at(square) != NO_PIECE)
+        {
+            piece p;
+            p.nr = game.at(square);
+            p.pos = squareToPosition(square);
+            pieceList.push_back(p);
+        }
+    }
+    turn = !game.whiteToMove();
+    speculated = false;
+    contradictions = 0;
+    //a new search only when the position changed, handing the same one over again would cancel the search and lose its depth
+    if (analyzer && game.key() != analysedkey)
+    {
+        analyzer->analyse(game); //only hands the position over, the search runs on the analyzer's thread
+    }
+    analysedkey = game.key();
+}
+
+bool Recognizer::undoMove()
+{
+    if (moveLog.empty())
+    {
+        return false;
+    }
+    moveEvent last = moveLog.back();
+    moveLog.pop_back();
+    game.unmakeMove();
+    undone.push_back(last);
+
+    recomputeClocks(); //the clock of the mover gets its time back, if it was charged
+    lastmovetime = moveLog.empty() ? startstamp : moveLog.back().released;
+    syncPieces();
+    return true;
+}
+
+bool Recognizer::redoMove()
+{
+    if (undone.empty() || !game.isLegal(undone.back().m))
+    {
+        return false;
+    }
+    moveEvent again = undone.back();
+    undone.pop_back();
+    lastmovetime = again.released;
+    commit(&again);
+    recomputeClocks();
+    return true;
+}
+
+bool Recognizer::correctMove(int ply, string san)
+{
+    if (ply < 0 || ply >= moveLog.size())
+    {
+        return false;
+    }
+    //find the move in the position it was played in
+    Board before = game;
+    for (int i = moveLog.size(); i > ply; i--)
+    {
+        before.unmakeMove();
+    }
+    chessMove m;
+    if (!before.parseSan(san, &m))
+    {
+        return false;
+    }
+
+    //take back everything from that ply on, and play it again with the corrected move
+    vector<moveEvent> later(moveLog.begin() + ply, moveLog.end());
+    while (moveLog.size() > ply)
+    {
+        game.unmakeMove();
+        moveLog.pop_back();
+    }
+    for (int i = 0; i < later.size(); i++)
+    {
+        moveEvent e = later[i]; //the timing stays the same
+        chessMove replay = i == 0 ? m : later[i].m;
+        if (!game.isLegal(replay))
+        {
+            break; //the moves after this one were read in a position that never happened
+        }
+        describeMove(replay, &e);
+        e.correction = i == 0 || later[i].correction;
+        e.confidence = i == 0 ? 100 : later[i].confidence;
+        commit(&e);
+    }
+    undone.clear();
+    recomputeClocks(); //the moves that weren't played again don't count any more
+    lastmovetime = moveLog.empty() ? startstamp : moveLog.back().released;
+    syncPieces();
+    return true;
+}
+
+bool Recognizer::setPosition(string fen)
+{
+    Board b;
+    if (!b.setFen(fen))
+    {
+        return false;
+    }
+    game = b;
+    moveLog.clear();
+    undone.clear();
+    //the clocks start over too, the time of the side to move runs from now on
+    clocks[0] = clocks[1] = timebase;
+    startseen = true;
+    startstamp = framestamp;
+    lastmovetime = framestamp;
+    syncPieces();
+    return true;
+}
+
+/* Function that looks which squares have a piece on them, by comparing them with the empty board
+ * a piece that has about the colour of its square can't be seen, so a square can also be unsure
+ *  input: the frame, and the array to fill in: 1 for a piece, -1 for empty and 0 for unsure
+ *  output: false if there's nothing to compare with
+ */
+bool Recognizer::measureOccupancy(const Mat& frame, int occupancy[64])
+{
+    bool any = false;
+    for (int square = 0; square < 64; square++)
+    {
+        occupancy[square] = 0;
+        double empty;
+        if (emptyknown)
+        {
+            position p = unorientPosition(squareToPosition(square), orient);
+            empty = emptybrightness[p.row*8 + p.column];
+        }
+        else if (!light.reference(square, &empty))
+        {
+            continue;
+        }
+        //in the lighting of the references
+        double diff = fabs((squareBrightness(frame, squarerects[square]) - light.offset())/light.gain() - empty);
+        if (diff > 2*PIECE_CONTRAST)
+        {
+            occupancy[square] = 1;
+        }
+        else if (diff < PIECE_CONTRAST/2)
+        {
+            occupancy[square] = -1;
+        }
+        any = true;
+    }
+    return any;
+}
+
+/* Function that counts how much the board contradicts the position
+ * a piece on a square the position says is empty counts double, it can't be explained by a piece that has the colour of its square
+ *  input: the occupancy, as measureOccupancy gives it
+ *  output: the amount of contradictions
+ */
+int Recognizer::mismatch(const int occupancy[64]) const
+{
+    int count = 0;
+    for (int square = 0; square < 64; square++)
+    {
+        bool empty = game.at(square) == NO_PIECE;
+        if (empty && occupancy[square] == 1)
+        {
+            count += 2;
+        }
+        else if (!empty && occupancy[square] == -1)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+/* Function that checks the position against the board, when nothing's moving
+ * when the board keeps contradicting the position, the last move gets replaced by the move that explains the board,
+ * or a move that was missed gets added. Only a move that explains (almost) every square counts, and only when it
+ * does so on RECHECK_COUNT checks in a row without any foreground on the board
+ *  input: the frame, and a pointer to the event to fill in
+ *  output: true if the position was corrected (the event is then the corrected or added move)
+ */
+bool Recognizer::checkPosition(const Mat& frame, moveEvent* event)
+{
+    int occupancy[64];
+    if (fgbusy || !measureOccupancy(frame, occupancy))
+    {//a hand resting on the board or the shadow of a sleeve isn't a piece
+        contradictions = 0;
+        return false;
+    }
+    int current = mismatch(occupancy);
+    if (current == 0)
+    {
+        if (!startseen && moveLog.empty())
+        {//the pieces are set up and nobody touches them: the game starts, and the clock of white with it
+            startseen = true;
+            startstamp = framestamp;
+            lastmovetime = framestamp;
+        }
+        contradictions = 0;
+        return false;
+    }
+
+    //a move that was missed: one more move explains the board
+    int best = current;
+    chessMove bestmove = {0, 0, NO_PIECE};
+    bool replace = false;
+    vector<chessMove> legal = game.legalMoves();
+    for (int i = 0; i < legal.size(); i++)
+    {
+        game.makeMove(legal[i]);
+        int score = mismatch(occupancy);
+        game.unmakeMove();
+        if (score < best)
+        {
+            best = score;
+            bestmove = legal[i];
+        }
+    }
+    //a move that was read wrong: another move instead of the last one explains the board
+    if (!moveLog.empty())
+    {
+        chessMove last = moveLog.back().m;
+        game.unmakeMove();
+        legal = game.legalMoves();
+        for (int i = 0; i < legal.size(); i++)
+        {
+            game.makeMove(legal[i]);
+            int score = mismatch(occupancy);
+            game.unmakeMove();
+            if (score < best)
+            {
+                best = score;
+                bestmove = legal[i];
+                replace = true;
+            }
+        }
+        game.makeMove(last);
+    }
+    if (best == current || best > RECHECK_TOLERANCE)
+    {//nothing explains the whole board, maybe something that isn't a piece is on it, or only part of it was seen
+        contradictions = 0;
+        return false;
+    }
+
+    //the same move has to explain the board on RECHECK_COUNT checks in a row before the history gets rewritten
+    if (contradictions > 0 && (encodeMove(bestmove) != encodeMove(pendingmove) || replace != pendingreplace))
+    {
+        contradictions = 0;
+    }
+    pendingmove = bestmove;
+    pendingreplace = replace;
+    contradictions++;
+    if (contradictions < RECHECK_COUNT)
+    {
+        return false;
+    }
+    contradictions = 0;
+
+    if (replace)
+    {
+        Board before = game;
+        before.unmakeMove();
+        correctMove(moveLog.size() - 1, before.toSan(bestmove));
+        moveLog.back().confidence = 80 - 10*best; //the board still disagreeing counts against it
+        *event = moveLog.back();
+        return true;
+    }
+    describeMove(bestmove, event);
+    (*event).frame = framecount;
+    (*event).latency = 0;
+    (*event).timestamp = framestamp;
+    (*event).released = framestamp; //when the move was really made isn't known
+    (*event).thinktime = framestamp - lastmovetime;
+    (*event).lag = framelag;
+    chargeClock(event); //the time up to this check, the move was made somewhere in it
+    (*event).correction = false;
+    (*event).confidence = 80 - 10*best;
+    lastmovetime = framestamp;
+    commit(event);
+    undone.clear();
+    return true;
+}
+
+/* Function that decides whether a frame needs to go through the full pipeline
+ * the frame gets shrunk to GATE_SIZExGATE_SIZE, so every pixel is the mean of a small block of the board,
+ * and compared to the previous shrunk frame. Most of the time the board is static, so most frames can be skipped
+ *  input: the frame
+ *  output: true if the frame should be processed, false if it can be skipped
+ */
+bool Recognizer::motionGate(const Mat& frame)
+{
+    Mat small;
+    resize(frame, small, Size(GATE_SIZE, GATE_SIZE), 0, 0, INTER_AREA); //INTER_AREA averages, which also gets rid of most of the noise
+    cvtColor(small, small, COLOR_BGR2GRAY);
+
+    bool changed = true;
+    if (!gateprev.empty())
+    {
+        Mat diff;
+        absdiff(small, gateprev, diff);
+        double maxdiff;
+        minMaxLoc(diff, NULL, &maxdiff);
+        changed = maxdiff > GATE_THRESHOLD;
+    }
+    gateprev = small;
+
+    if (changed)
+    {
+        gatehold = GATE_HOLD;
+    }
+
+    //while a move is being counted (or we're in the cooldown after one) every frame counts, so the gate stays open
+    //the same goes for as long as the background is still learning the new position of the pieces
+    if (gatehold > 0 || movcount != 0 || fgbusy)
+    {
+        if (gatehold > 0)
+        {
+            gatehold--;
+        }
+        gateidle = 0;
+        return true;
+    }
+
+    //idle: let a frame through every now and then, so the background keeps learning
+    gateidle++;
+    if (gateidle >= GATE_IDLE_INTERVAL)
+    {
+        gateidle = 0;
+        return true;
+    }
+    return false;
+}
+
+/* Function that detects if there was a significant enough movement of a piece on the foregroundmask
+ *  input: the foregroundmask and a pointer to a vector of Rectangles
+ *  output: a boolean of succes, and a filled vector of bounding rectangles
+ */
+bool Recognizer::detectMovement(const Mat& mask, vector<Rect>* boundRectList)
+{
+    movementAreas(mask, dilateelement, boundRectList);
+
+    //if there's 2 contours, increase the movcount
+    //(also increase if the movcount is currently negative)
+    //else we decrease it
+    if ((*boundRectList).size() == 2 || movcount < 0)
+    {
+        if (movcount == 0)
+        {
+            movstart = framecount; //the hand just left the board, remember when
+            movstarttime = framestamp;
+        }
+        movcount += C_INCR;
+    }
+    else if (movcount > 0)
+    {
+        movcount--;
+    }
+
+    //once it passes a threshold, we can assume a turn happened!
+    if (movcount > movementthreshold)
+    {
+        movcount = -250;
+        turn = !turn;
+        return true;
+    }
+    return false;
+}
+
+/* Function that finds the specific movement that happened on a turn
+ *  input: bounding rectangles of the 2 contours on the foreground, and a pointer to the event to fill in
+ *  output: true if a move was found
+ */
+bool Recognizer::findMovement(vector<Rect> boundRectList, moveEvent* event)
+{
+    vector<position> poslist; //make empty vector which will contain the detected positions
+
+    for (int i = 0; i < boundRectList.size(); i++) 
+    {
+        int x = boundRectList[i].x + boundRectList[i].width/2; //calculate the centre of the boundingrects
+        int y = boundRectList[i].y + boundRectList[i].height/2;
+        poslist.push_back(positionAt(x,y));
+    }
+    //now we have the 2 areas where movement has been detected
+    //if they're the squares of a legal move, everything about it is already known
+    //(a move that isn't legal doesn't get played, checkPosition finds a missed move once the board shows it)
+    if (matchCandidate(poslist, event))
+    {
+        (*event).confidence = 100;
+        return true;
+    }
+    return false;
+}
+
+/* Function that works out every legal move in the current position before it's played:
+ * which squares change, and how it's written. When the move comes, matchCandidate only has to look it up
+ *  input: void
+ *  output: void
+ */
+void Recognizer::speculate()
+{
+    candidates.clear();
+    candidatelookup.clear();
+    vector<chessMove> legal = game.legalMoves();
+    for (int i = 0; i < legal.size(); i++)
+    {
+        moveCandidate c;
+        c.m = legal[i];
+        c.captured = game.at(c.m.to) != NO_PIECE ? c.m.to : NO_PIECE;
+
+        int nr = game.at(c.m.from);
+        if ((nr == PAWN_W || nr == PAWN_B) && fileOf(c.m.from) != fileOf(c.m.to) && game.at(c.m.to) == NO_PIECE)
+        {//en passant: the pawn that gets taken is next to the square the pawn goes to
+            c.captured = squareOf(rankOf(c.m.from), fileOf(c.m.to));
+        }
+
+        c.san = game.toSan(c.m);
+        piece moved;
+        moved.nr = nr;
+        moved.pos = squareToPosition(c.m.to);
+        c.notation = moveToString(moved, c.captured != NO_PIECE);
+
+        //looked up on the square that's left and the one that's reached, which is what the vision sees
+        //(the rook of a castling move and the pawn taken en passant aren't needed to tell the move apart)
+        //the 4 promotions have the same squares, the vision can't tell them apart so it gets the queen
+        uint64_t key = (1ULL << c.m.from) | (1ULL << c.m.to);
+        unordered_map<uint64_t, int>::iterator found = candidatelookup.find(key);
+        if (found == candidatelookup.end() || c.m.promotion == QUEEN_W || c.m.promotion == QUEEN_B)
+        {
+            candidatelookup[key] = candidates.size();
+        }
+        candidates.push_back(c);
+    }
+    speculated = true;
+}
+
+/* Function that looks up the squares where movement was seen in the candidates
+ *  input: the positions of the movement, and a pointer to the event to fill in
+ *  output: true if they're the square that's left and the one that's reached by a legal move
+ */
+bool Recognizer::matchCandidate(const vector<position>& poslist, moveEvent* event)
+{
+    if (!speculated)
+    {//the move came before the board was idle long enough
+        speculate();
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < poslist.size(); i++)
+    {
+        if (poslist[i].row < 0 || poslist[i].column < 0)
+        {
+            return false;
+        }
+        seen |= 1ULL << positionToSquare(poslist[i]);
+    }
+    unordered_map<uint64_t, int>::iterator found = candidatelookup.find(seen);
+    if (found == candidatelookup.end())
+    {
+        return false;
+    }
+
+    const moveCandidate& c = candidates[found->second];
+    describeMove(c.m, event);
+    (*event).notation = c.notation;
+    (*event).san = c.san;
+    return true;
+}
+
+/* Function that finds all the legal moves for a piece, from the board (so a move that leaves the king in check isn't one)
+ * a piece of the side that isn't to move gets the moves it would have if it were
+ *  input: the piece
+ *  output: the positions it can move to
+ */
+vector<position> Recognizer::findLegalMoves(piece p) const
+{
+    vector<position> possiblePositions;
+    if (p.pos.row < 0 || p.pos.column < 0)
+    {
+        return possiblePositions;
+    }
+    Board b = game;
+    if (isWhite(p.nr) != game.whiteToMove())
+    {
+        istringstream fields(game.toFen());
+        string placement, side, rights;
+        fields >> placement >> side >> rights;
+        b.setFen(placement + (side == "w" ? " b " : " w ") + rights + " - 0 1");
+    }
+    int square = positionToSquare(p.pos);
+    vector<chessMove> legal = b.legalMoves();
+    for (int i = 0; i < legal.size(); i++)
+    {
+        //the 4 promotions go to the same square
+        if (legal[i].from == square && (legal[i].promotion == NO_PIECE || legal[i].promotion == QUEEN_W || legal[i].promotion == QUEEN_B))
+        {
+            possiblePositions.push_back(squareToPosition(legal[i].to));
+        }
+    }
+    return possiblePositions;
+}
+
+/* Function that looks up the piece on a position
+ *  input: the position, and a pointer to the piece to fill in
+ *  output: true if there is a piece on that position
+ */
+bool Recognizer::findPieceOnPos(position p, piece* Piece) const
+{
+    if (7 < p.column || p.column < 0 || p.row < 0 || 7 < p.row)
+    {
+        return false;
+    }
+    for (int i = 0; i < pieceList.size(); i++)
+    {
+        if (pieceList[i].pos.column == p.column && pieceList[i].pos.row == p.row)
+        {
+            *Piece = pieceList[i];
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,175 @@
+/* The recognizer: turns a stream of frames of a chess board into moves
+ * every recognizer has its own state, so a process can track as many boards as it wants.
+ * It doesn't open windows or print anything, that's up to the program using it.
+ */
+#ifndef RECOGNIZER_H
+#define RECOGNIZER_H
+
+#include "chessdetection.h"
+#include "analysis.h"
+#include "tiledbackground.h"
+#include "lighting.h"
+
+//a move that was registered
+struct moveEvent
+{
+    piece moved;        //the piece that moved, with its new position
+    position from;
+    bool capture;
+    piece captured;     //the piece that got taken (only when capture is true), with its old position
+    bool white;         //true if it was white's move
+    string notation;    //the move in algebraic notation, as it is written to the outputfile
+    string san;         //the move in standard algebraic notation, empty if it wasn't a legal move
+    chessMove m;        //the move on the board
+    int frame;          //frame on which the move was registered
+    int latency;        //frames between the hand leaving the board and the move being registered
+    double timestamp;   //timestamp of the frame on which the move was registered
+    double released;    //timestamp of the frame on which the hand left the board, when the move was really made
+    double thinktime;   //milliseconds between the previous move (or the start of the game) and this one
+    double clock;       //milliseconds left on the mover's clock after the move, -1 without a time control
+    bool charged;       //true if the thinktime went off the mover's clock (and the increment on it)
+    double lag;         //milliseconds the pipeline was behind the frames when the move was registered
+    uint64_t key;       //zobrist key of the position after the move
+    int repetitions;    //how often the position after the move was on the board (3 is a threefold repetition)
+    bool fiftymoves;    //true if the 50-move rule can be claimed after the move
+    int ply;            //index of the move in moves(), 0 is white's first move
+    bool correction;    //true if the move replaces the move that was registered before on the same ply
+    int confidence;     //0-100, how sure the recognizer is of the move (100 for a legal move that matched, or one the user typed)
+    bool analysed;      //true if there was an analysis of the position before the move
+    analysisResult analysis; //the newest analysis of the position before the move, to compare the move with
+};
+
+//a legal move for the side to move, worked out before it's played
+struct moveCandidate
+{
+    chessMove m;
+    int captured;       //square of the piece that gets taken, NO_PIECE if nothing gets taken
+    string san;
+    string notation;    //as moveToString writes it
+};
+
+class Recognizer
+{
+public:
+    Recognizer();
+
+    void reset(); //start a new game, the corners of the board are kept
+    void setCorners(const vector<Point2f>& corners);
+    const vector<Point2f>& corners() const { return cornerlist; }
+
+    /* Function that looks at the empty board to find out how it's turned
+     * the colour of the squares tells which corner a1 is in, up to a half turn;
+     * which side the white pieces appear on once they're put on the board decides the rest
+     *  input: a frame of the empty board (after the corners are set)
+     *  output: void
+     */
+    void calibrateEmptyBoard(const Mat& frame);
+    void setOrientation(int quarterturns); //turns of the board from the standard view (white at the top, h-file on the left)
+    int orientation() const { return orient; }
+    bool orientationKnown() const { return !orientationpending; } //false until the pieces decided the side
+    position positionAt(int x, int y) const; //the square (as a position on the board) that a point of the image is on
+    Point squareCentre(position p) const;    //centre of a square in the image
+    void setMovementThreshold(int threshold) { movementthreshold = threshold; }
+    void setTimeControl(double basems, double incrementms); //0 for no clocks
+    void setAnalyzer(Ptr<Analyzer> a); //analyse the position after every move, on the analyzer's thread
+    bool pollAnalysis(analysisResult* result) { return analyzer && analyzer->poll(result); } //true if there's a new result
+
+    /* Function that runs one frame through the detection pipeline
+     *  input: the frame (in the same coordinates as the corners), and its timestamp in milliseconds
+     *  output: the moves that were registered on this frame (usually none)
+     */
+    vector<moveEvent> pushFrame(const Mat& frame, double timestamp);
+
+    bool whiteToMove() const { return !turn; }
+    const vector<piece>& pieces() const { return pieceList; }
+    const Board& board() const { return game; } //the same position, with its zobrist key and history
+    const vector<moveEvent>& moves() const { return moveLog; }
+    bool findPieceOnPos(position p, piece* Piece) const;
+    vector<position> findLegalMoves(piece p) const;
+
+    //corrections, for when a move was registered wrong (the recognizer also corrects itself when the board contradicts it)
+    bool undoMove();    //take back the last move, false if there's nothing to take back
+    bool redoMove();    //play the last move that was taken back again
+    bool correctMove(int ply, string san); //replace a move, the moves after it are kept as long as they're still legal
+    bool setPosition(string fen); //start over from a position, when nothing else helps
+
+    //state of the pipeline, to show what it's doing
+    int movementCount() const { return movcount; }
+    int frameCount() const { return framecount; }
+    bool lastFrameProcessed() const { return processed; } //false if the motion gate skipped the last frame
+    double lag() const { return framelag; } //milliseconds the last frame was processed later than it was captured
+    const Mat& foreground() const { return fgmask; }
+    void background(Mat& bg) const { bgdet->getBackgroundImage(bg); }
+    TiledBackground& backgroundModel() { return *bgdet; } //to give tiles their own learning rate, freeze or reset them
+    const LightingCompensator& lighting() const { return light; } //the correction that's applied on the frames
+
+private:
+    bool motionGate(const Mat& frame);
+    void updateSquareRects();
+    void detectSide(const Mat& frame);
+    bool detectMovement(const Mat& mask, vector<Rect>* boundRectList);
+    bool findMovement(vector<Rect> boundRectList, moveEvent* event);
+    void speculate();
+    bool matchCandidate(const vector<position>& poslist, moveEvent* event);
+    void describeMove(chessMove m, moveEvent* event);
+    bool commit(moveEvent* event);
+    void chargeClock(moveEvent* event);
+    void recomputeClocks();
+    void syncPieces();
+    bool measureOccupancy(const Mat& frame, int occupancy[64]);
+    int mismatch(const int occupancy[64]) const;
+    bool checkPosition(const Mat& frame, moveEvent* event);
+
+    vector<Point2f> cornerlist;
+    vector<Rect> imagerects;  //middle part of every square, in the image (row*8+column, row 0 at the top)
+    vector<Rect> squarerects; //the same rectangles by square (a1=0 .. h8=63), empty until the corners are known
+    int orient;         //quarter turns of the board, see orientPosition
+    bool orientationpending; //true while waiting for the pieces to decide the side
+    double emptybrightness[64]; //brightness of every square in the image on the empty board
+    bool emptyknown;    //true once calibrateEmptyBoard measured emptybrightness
+    int movementthreshold;
+    Ptr<TiledBackground> bgdet; //a MOG2 model per tile, updated in parallel
+    Mat erodeelement;
+    Mat dilateelement;
+    Mat fgmask;         //kept between frames, so skipped frames can still show the last one
+    LightingCompensator light;
+    Mat corrected;      //the frame after the lighting correction
+    bool processed;
+
+    int movcount;       //counter that counts how many frames there were with 2 contours
+    bool turn;          //boolean to remember who's turn it is. False = white, true = black
+    vector<piece> pieceList; //vector containing all the pieces and their location (with (-1;-1) being taken)
+    vector<moveEvent> moveLog; //every move that was registered, in the order they were played
+    vector<moveEvent> undone; //moves that were taken back, the last one first to be played again
+    int contradictions; //amount of checks in a row on which the same move explained the board better than the position
+    chessMove pendingmove; //that move
+    bool pendingreplace; //true if it replaces the last move, false if it's a move that was missed
+    Board game;         //follows every registered move, for the zobrist keys and the repetitions
+    int framecount;     //amount of frames that were pushed
+    int movstart;       //frame on which movcount started counting up for the current move
+
+    double framestamp;  //timestamp of the frame that's being processed
+    double movstarttime; //timestamp of the frame movstart
+    double lastmovetime; //timestamp of the hand leaving the board on the previous move (or of the start of the game)
+    double startstamp;  //timestamp the game started: the starting position was first seen on the board (or set), else the first frame
+    bool startseen;     //true once the starting position was seen on the board, or set with setPosition
+    double timebase;    //time control, in milliseconds (0 for none)
+    double timeincrement;
+    double clocks[2];   //milliseconds left for white and black
+    double firststamp;  //timestamp of the first frame, and the moment it was pushed, for the lag
+    int64 firsttick;
+    double framelag;
+    Ptr<Analyzer> analyzer; //empty if nothing gets analysed
+    uint64_t analysedkey; //key of the position the analyzer was handed last, the same position isn't handed over again
+
+    vector<moveCandidate> candidates; //every legal move in the current position
+    unordered_map<uint64_t, int> candidatelookup; //from and to square of a candidate -> its index in candidates
+    bool speculated;    //false until the candidates of the current position are worked out
+
+    Mat gateprev;       //downsampled greyscale version of the previous frame, used by the motion gate
+    int gatehold;       //counter of how many frames the gate still stays open
+    int gateidle;       //counter of how many frames were skipped since the last full pass
+    bool fgbusy;        //true as long as the last foregroundmask still had more than GATE_BUSY_PIXELS of foreground in it
+};
+
+#endif
@@ -0,0 +1,342 @@
+/* Tool that replays recorded games through the detection pipeline and compares the result with the real game
+ * every line of the corpus file contains the path to a video and the path to the pgn of the game in that video,
+ * eg "games/match1.mp4 games/match1.pgn". The video has to start with an empty board, just like a live game.
+ * Instead of a video, "synth" renders the pgn with the synthetic board and feeds it straight into the pipeline,
+ * and "images:<directory>" reads the frames from a directory of images.
+ * No windows are opened and no waitKeys are used, so the same videos always give the same moves.
+ */
+
+#include <sstream>
+#include <iomanip>
+#include "framesource.h"
+#include "recognizer.h"
+
+struct gameReport
+{
+    string name;
+    bool calibrated;
+    int truthplies;     //amount of moves in the pgn
+    int detectedplies;  //amount of moves the pipeline registered
+    int correct;        //amount of moves that match the pgn on the same ply
+    int divergence;     //first ply (starting at 1) where the pipeline and the pgn don't agree, 0 if they fully agree
+    double meanlatency; //mean amount of frames between the hand leaving the board and the move being registered
+    int maxlatency;
+    int frames;
+    double fps;         //frames per second of the pipeline itself (decoding the video isn't counted)
+};
+
+string stripChecks(string san);
+string reduceNotation(string san);
+gameReport replayGame(string videopath, string pgnpath, int calibframes);
+void writeReport(ostream& out, vector<gameReport> reports);
+
+int main(int argc, const char **argv)
+{
+    CommandLineParser parser(argc, argv,
+    "{ help h usage ?    || show this message }"
+    "{ corpus c          || path to a file with on every line a video and its pgn }"
+    "{ video v           || path to a single video to replay (use together with --pgn) }"
+    "{ pgn               || path to the pgn of the single video }"
+    "{ synth s           || render the pgn with the synthetic board instead of reading a video }"
+    "{ report r          || path to the file where the report is written to; default is only stdout }"
+    "{ calibframes       |300| amount of frames at the start of a video in which the board has to be found }"
+    );
+
+    if (parser.has("help"))
+    {
+        parser.printMessage();
+        return 0;
+    }
+
+    string corpus_location(parser.get<string>("corpus"));
+    string video_location(parser.get<string>("video"));
+    string pgn_location(parser.get<string>("pgn"));
+    string report_location(parser.get<string>("report"));
+    int calibframes = parser.get<int>("calibframes");
+
+    //make a list of all the games we need to replay
+    vector<pair<string, string>> games;
+    if (parser.has("synth"))
+    {
+        games.push_back(make_pair(string("synth"), pgn_location));
+    }
+    else if (!video_location.empty())
+    {
+        games.push_back(make_pair(video_location, pgn_location));
+    }
+    if (!corpus_location.empty())
+    {
+        ifstream corpus(corpus_location);
+        if (!corpus.is_open())
+        {
+            cerr << "Cannot open corpus " << corpus_location << endl;
+            return -1;
+        }
+        //relative paths in the corpus are relative to the corpus itself
+        string dir = "";
+        size_t slash = corpus_location.find_last_of('/');
+        if (slash != string::npos)
+        {
+            dir = corpus_location.substr(0, slash + 1);
+        }
+
+        string line;
+        while (getline(corpus, line))
+        {
+            istringstream linestream(line);
+            string video, pgn;
+            if (!(linestream >> video) || video[0] == '#')
+            {
+                continue; //empty line or comment
+            }
+            linestream >> pgn;
+            size_t colon = video.find(':') == string::npos ? 0 : video.find(':') + 1; //eg "images:<directory>"
+            if (video != "synth" && colon < video.size() && video[colon] != '/')
+            {
+                video.insert(colon, dir);
+            }
+            if (!pgn.empty() && pgn[0] != '/')
+            {
+                pgn = dir + pgn;
+            }
+            games.push_back(make_pair(video, pgn));
+        }
+    }
+
+    if (games.empty() && corpus_location.empty())
+    {
+        cerr << "No games to replay, use --corpus, --video or --synth" << endl;
+        parser.printMessage();
+        return -1;
+    }
+
+    vector<gameReport> reports;
+    for (int i = 0; i < games.size(); i++)
+    {
+        reports.push_back(replayGame(games[i].first, games[i].second, calibframes));
+    }
+
+    writeReport(cout, reports);
+    if (!report_location.empty())
+    {
+        ofstream report(report_location);
+        writeReport(report, reports);
+    }
+
+    //a game where the board was never found counts as a failed run
+    for (int i = 0; i < reports.size(); i++)
+    {
+        if (!reports[i].calibrated)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Function that strips the check, mate and annotation marks of a move in standard algebraic notation
+ *  input: the move as it is written in a pgn (eg "exd5+", "Nbd7!?")
+ *  output: the move without them (eg "exd5", "Nbd7")
+ */
+string stripChecks(string san)
+{
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?'))
+    {
+        san.pop_back();
+    }
+    return san;
+}
+
+/* Function that reduces a move in standard algebraic notation to the notation the pipeline writes
+ * the pipeline doesn't write checks, disambiguations, promotions or the file of a capturing pawn
+ *  input: the move as it is written in a pgn (eg "exd5+", "Nbd7", "e8=Q")
+ *  output: the reduced move (eg "xd5", "Nd7", "e8")
+ */
+string reduceNotation(string san)
+{
+    san = stripChecks(san);
+    //strip the promotion
+    size_t equals = san.find('=');
+    if (equals != string::npos)
+    {
+        san = san.substr(0, equals);
+    }
+    if (san.size() < 2 || san[0] == 'O')
+    {
+        return san; //castling, written the same way by the pipeline
+    }
+
+    string reduced = "";
+    if (string("KQRBN").find(san[0]) != string::npos)
+    {
+        reduced += san[0];
+    }
+    if (san.find('x') != string::npos)
+    {
+        reduced += "x";
+    }
+    reduced += san.substr(san.size() - 2);
+    return reduced;
+}
+
+/* Function that replays one video through the pipeline
+ *  input: the path to the video (or "synth") and its pgn, and the amount of frames that can be used to find the board
+ *  output: the report of the game
+ */
+gameReport replayGame(string videopath, string pgnpath, int calibframes)
+{
+    gameReport report;
+    report.name = videopath == "synth" ? "synth:" + pgnpath : videopath;
+    report.calibrated = false;
+    report.detectedplies = 0;
+    report.correct = 0;
+    report.divergence = 0;
+    report.meanlatency = 0;
+    report.maxlatency = 0;
+    report.frames = 0;
+    report.fps = 0;
+
+    vector<string> truth = readPgnMoves(pgnpath);
+    report.truthplies = truth.size();
+
+    //synthetic games are rendered in memory, so there's no codec in the way
+    Ptr<FrameSource> source;
+    if (videopath == "synth")
+    {
+        source = makePtr<SynthSource>(synthConfig(), truth);
+    }
+    else
+    {
+        source = openFrameSource(videopath);
+    }
+    if (!source->isOpened())
+    {
+        cerr << "Cannot open video " << videopath << endl;
+        return report;
+    }
+
+    Recognizer recognizer;
+
+    //find the board, the same way a user would wait for the corners before pressing enter
+    Mat frame;
+    vector<Point2f> tilecorners;
+    for (int i = 0; i < calibframes && source->read(frame); i++)
+    {
+        resize(frame, frame, Size(IMG_H, IMG_W));
+        findAllChessboardCorners(frame, &tilecorners);
+        if (tilecorners.size() == 49)
+        {
+            report.calibrated = true;
+            break;
+        }
+    }
+    if (!report.calibrated)
+    {
+        cerr << "No board found in the first " << calibframes << " frames of " << videopath << endl;
+        return report;
+    }
+    recognizer.setCorners(tilecorners);
+    recognizer.calibrateEmptyBoard(frame); //the board is found on an empty board, so its colours can be read
+
+    //the timestamps come from the source (the position in the video), never from the clock
+    int64 ticks = 0;
+    while (source->read(frame))
+    {
+        resize(frame, frame, Size(IMG_H, IMG_W));
+        int64 start = getTickCount();
+        recognizer.pushFrame(frame, source->timestamp());
+        ticks += getTickCount() - start;
+    }
+    report.frames = recognizer.frameCount();
+    if (ticks > 0)
+    {
+        report.fps = report.frames / (ticks / getTickFrequency());
+    }
+    const vector<moveEvent>& moveLog = recognizer.moves();
+
+    //compare what we saw with what was played
+    report.detectedplies = moveLog.size();
+    int latencysum = 0;
+    for (int i = 0; i < moveLog.size(); i++)
+    {
+        latencysum += moveLog[i].latency;
+        report.maxlatency = max(report.maxlatency, moveLog[i].latency);
+
+        //the full san, so exd5 instead of cxd5 or Nbd7 instead of Nfd7 is a wrong move
+        //(only a move without a san falls back to the notation, which can't tell those apart)
+        bool match = false;
+        if (i < truth.size())
+        {
+            match = moveLog[i].san.empty() ? moveLog[i].notation == reduceNotation(truth[i])
+                                           : stripChecks(moveLog[i].san) == stripChecks(truth[i]);
+        }
+        if (match)
+        {
+            report.correct++;
+        }
+        else if (report.divergence == 0)
+        {
+            report.divergence = i + 1;
+        }
+    }
+    if (report.divergence == 0 && moveLog.size() < truth.size())
+    {
+        report.divergence = moveLog.size() + 1; //we missed the moves at the end
+    }
+    if (!moveLog.empty())
+    {
+        report.meanlatency = (double)latencysum / moveLog.size();
+    }
+    return report;
+}
+
+/* Function that writes the report of all the games, one line per game
+ * so two reports can be diffed to see what a change did. The fps differs from machine to machine, so it's on lines
+ * of its own at the end, starting with "fps": grep -v '^fps' leaves them out when the reports come from different machines
+ *  input: the stream to write to, and the reports
+ *  output: void
+ */
+void writeReport(ostream& out, vector<gameReport> reports)
+{
+    out << "# game | plies (pgn/detected) | correct | accuracy | first divergence | latency in frames (mean/max) | frames" << endl;
+    int truthtotal = 0;
+    int correcttotal = 0;
+    for (int i = 0; i < reports.size(); i++)
+    {
+        gameReport r = reports[i];
+        out << r.name << " | ";
+        if (!r.calibrated)
+        {
+            out << "no board found" << endl;
+            continue;
+        }
+        double accuracy = r.truthplies > 0 ? 100.0 * r.correct / r.truthplies : 0;
+        out << r.truthplies << "/" << r.detectedplies << " | "
+            << r.correct << " | "
+            << fixed << setprecision(1) << accuracy << "% | "
+            << (r.divergence == 0 ? string("-") : to_string(r.divergence)) << " | "
+            << setprecision(1) << r.meanlatency << "/" << r.maxlatency << " | "
+            << r.frames << endl;
+        truthtotal += r.truthplies;
+        correcttotal += r.correct;
+    }
+    double accuracy = truthtotal > 0 ? 100.0 * correcttotal / truthtotal : 0;
+    out << "total | " << correcttotal << "/" << truthtotal << " | " << fixed << setprecision(1) << accuracy << "%" << endl;
+
+    //frames per second of the pipeline itself, depends on the machine
+    int frametotal = 0;
+    double secondstotal = 0;
+    for (int i = 0; i < reports.size(); i++)
+    {
+        if (reports[i].calibrated && reports[i].fps > 0)
+        {
+            out << "fps | " << reports[i].name << " | " << setprecision(1) << reports[i].fps << endl;
+            frametotal += reports[i].frames;
+            secondstotal += reports[i].frames / reports[i].fps;
+        }
+    }
+    if (secondstotal > 0)
+    {
+        out << "fps | total | " << setprecision(1) << frametotal / secondstotal << endl;
+    }
+}
@@ -0,0 +1,224 @@
+/* Generator of synthetic videos of a chess game
+ * the board is drawn the way the pipeline expects it: white at the top of the image and the h-file on the left
+ */
+
+#include <cmath>
+#include "synthboard.h"
+
+static Point lerp(Point a, Point b, double t)
+{
+    return Point(a.x + (b.x - a.x)*t, a.y + (b.y - a.y)*t);
+}
+
+SynthBoard::SynthBoard(synthConfig config, vector<string> pgnmoves) : config(config), rng(config.seed)
+{
+    //work out the moves on a separate board, so we only play the legal ones
+    Board scratch;
+    for (int i = 0; i < pgnmoves.size(); i++)
+    {
+        chessMove m;
+        if (!scratch.parseSan(pgnmoves[i], &m))
+        {
+            cerr << "Illegal move " << pgnmoves[i] << " on ply " << i + 1 << ", the game stops here" << endl;
+            break;
+        }
+        san.push_back(scratch.toSan(m));
+        moves.push_back(m);
+        scratch.makeMove(m);
+    }
+
+    //make the schedule: empty board, pieces on the board, and then a move every moveframes+thinkframes frames
+    int start = config.emptyframes + config.settleframes;
+    for (int i = 0; i < moves.size(); i++)
+    {
+        movestart.push_back(start);
+        handleft.push_back(start + config.moveframes);
+        start += config.moveframes + config.thinkframes;
+    }
+    if (moves.empty())
+    {
+        total = start;
+    }
+    else
+    {
+        total = handleft.back() + config.settleframes;
+    }
+    applied = 0;
+    frame = 0;
+
+    //the board gets a border of one square, so the corners can be found
+    int side = 10*config.cell;
+    topsize = Size(side, side);
+    vector<Point2f> src = {Point2f(0, 0), Point2f(side, 0), Point2f(side, side), Point2f(0, side)};
+    float left = 0.05*config.width;
+    float right = 0.95*config.width;
+    float top = 0.05*config.height;
+    float bottom = 0.95*config.height;
+    float inset = config.tilt*(right - left)/2; //the far side of the board is narrower
+    vector<Point2f> dst = {Point2f(left + inset, top), Point2f(right - inset, top), Point2f(right, bottom), Point2f(left, bottom)};
+    perspective = getPerspectiveTransform(src, dst);
+}
+
+/* Function that gives the centre of a square on the board seen from above
+ *  input: the square
+ *  output: the centre in pixels
+ */
+Point SynthBoard::squareCentre(int square) const
+{
+    int x = config.cell + (7 - fileOf(square))*config.cell + config.cell/2;
+    int y = config.cell + rankOf(square)*config.cell + config.cell/2;
+    return Point(x, y);
+}
+
+/* Function that draws a piece as a round token with its letter on it
+ *  input: the image, the number of the piece and where to draw it
+ *  output: void
+ */
+void SynthBoard::drawPiece(Mat& img, int nr, Point centre)
+{
+    const string letters = "PPKKQQBBNNRR";
+    Scalar fill = isWhite(nr) ? Scalar(235,235,235) : Scalar(30,30,30);
+    Scalar edge = isWhite(nr) ? Scalar(40,40,40) : Scalar(200,200,200);
+
+    double size = 0.38;
+    if (nr == PAWN_W || nr == PAWN_B)
+    {
+        size = 0.28;
+    }
+    if (nr == KING_W || nr == KING_B || nr == QUEEN_W || nr == QUEEN_B)
+    {
+        size = 0.42;
+    }
+    int radius = size*config.cell;
+    circle(img, centre, radius, fill, FILLED, LINE_AA);
+    circle(img, centre, radius, edge, 2, LINE_AA);
+
+    string letter(1, letters[nr]);
+    double scale = config.cell/60.0;
+    int baseline;
+    Size textsize = getTextSize(letter, FONT_HERSHEY_SIMPLEX, scale, 2, &baseline);
+    putText(img, letter, Point(centre.x - textsize.width/2, centre.y + textsize.height/2), FONT_HERSHEY_SIMPLEX, scale, edge, 2, LINE_AA);
+}
+
+/* Function that draws a hand with an arm that comes in from the side of the player
+ *  input: the image, where the hand is and whether the arm comes from the top
+ *  output: void
+ */
+void SynthBoard::drawHand(Mat& img, Point tip, bool fromtop)
+{
+    Scalar skin(120,160,215);
+    Point elbow(tip.x + config.cell/2, fromtop ? -3*config.cell : img.rows + 3*config.cell);
+    line(img, tip, elbow, skin, config.cell/2, LINE_AA);
+    ellipse(img, tip, Size(0.45*config.cell, 0.35*config.cell), 0, 0, 360, skin, FILLED, LINE_AA);
+}
+
+/* Function that draws the board seen from straight above
+ *  input: the image to draw on, the square whose piece isn't drawn (NO_PIECE if all are drawn),
+ *         the piece the hand carries, and where the hand is (it isn't drawn when it's outside the image)
+ *  output: void
+ */
+void SynthBoard::render(Mat& img, int hidden, int carried, Point hand, bool whitehand)
+{
+    img = Mat(topsize, CV_8UC3, Scalar(190,195,200));
+    for (int square = 0; square < 64; square++)
+    {
+        bool dark = (rankOf(square) + fileOf(square))%2 == 0; //a1 is a dark square
+        Point centre = squareCentre(square);
+        Point corner(centre.x - config.cell/2, centre.y - config.cell/2);
+        rectangle(img, corner, Point(corner.x + config.cell - 1, corner.y + config.cell - 1), dark ? Scalar(50,80,100) : Scalar(215,235,245), FILLED);
+    }
+
+    if (frame >= config.emptyframes)
+    {
+        for (int square = 0; square < 64; square++)
+        {
+            if (square != hidden && board.at(square) != NO_PIECE)
+            {
+                drawPiece(img, board.at(square), squareCentre(square));
+            }
+        }
+    }
+    if (carried != NO_PIECE)
+    {
+        drawPiece(img, carried, hand);
+    }
+    if (config.hands && Rect(0, 0, img.cols, img.rows).contains(hand))
+    {
+        drawHand(img, hand, whitehand); //white sits at the top
+    }
+}
+
+/* Function that makes the next frame of the video
+ *  input: the mat to put the frame in
+ *  output: false if the game is over
+ */
+bool SynthBoard::nextFrame(Mat& out)
+{
+    if (frame >= total)
+    {
+        return false;
+    }
+
+    int hidden = NO_PIECE;
+    int carried = NO_PIECE;
+    Point hand(-1000, -1000);
+    bool whitehand = true;
+
+    //find the move that's being made (if any)
+    for (int i = 0; i < moves.size(); i++)
+    {
+        int t = frame - movestart[i];
+        if (t < 0 || t >= config.moveframes)
+        {
+            continue;
+        }
+        double p = (double)t/config.moveframes;
+        whitehand = i%2 == 0;
+        Point from = squareCentre(moves[i].from);
+        Point to = squareCentre(moves[i].to);
+        Point edgefrom(from.x, whitehand ? -config.cell : topsize.height + config.cell);
+        Point edgeto(to.x, edgefrom.y);
+
+        if (p < 1.0/3)
+        {//reach for the piece
+            hand = lerp(edgefrom, from, p*3);
+        }
+        else if (p < 2.0/3)
+        {//carry it to its new square
+            hidden = moves[i].from;
+            carried = board.at(moves[i].from);
+            hand = lerp(from, to, (p - 1.0/3)*3);
+        }
+        else
+        {//put it down and pull back the hand
+            if (applied == i)
+            {
+                board.makeMove(moves[i]);
+                applied++;
+            }
+            hand = lerp(to, edgeto, (p - 2.0/3)*3);
+        }
+    }
+
+    Mat top;
+    render(top, hidden, carried, hand, whitehand);
+    warpPerspective(top, out, perspective, Size(config.width, config.height), INTER_LINEAR, BORDER_CONSTANT, Scalar(90,100,110));
+
+    //lighting, with a slow drift
+    double gain = config.gain*(1 + config.drift*sin(2*M_PI*frame/(config.fps*60)));
+    out.convertTo(out, -1, gain, config.offset);
+
+    //noise, in 16 bit so it can go below zero before it gets clipped
+    if (config.noise > 0)
+    {
+        Mat noise(out.size(), CV_16SC3);
+        rng.fill(noise, RNG::NORMAL, Scalar::all(0), Scalar::all(config.noise));
+        Mat wide;
+        out.convertTo(wide, CV_16SC3);
+        wide = wide + noise;
+        wide.convertTo(out, CV_8UC3);
+    }
+
+    frame++;
+    return true;
+}
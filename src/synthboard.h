@@ -0,0 +1,61 @@
+/* Generator of synthetic videos of a chess game
+ * it draws a board with pieces, seen through a camera with some perspective, lighting and noise,
+ * and plays the moves of a pgn with a hand that picks up and puts down the pieces.
+ */
+#ifndef SYNTHBOARD_H
+#define SYNTHBOARD_H
+
+#include "chessdetection.h"
+
+struct synthConfig
+{
+    int width = 640;        //size of the frames
+    int height = 480;
+    int cell = 48;          //size of a square before the perspective is applied
+    double tilt = 0.15;     //how much narrower the far side of the board gets, 0 is straight from above
+    double gain = 1.0;      //lighting: every pixel becomes gain*pixel + offset
+    double offset = 0;
+    double drift = 0;       //amplitude of a slow (one minute period) change of the gain, eg 0.1 is +-10%
+    double noise = 2.0;     //standard deviation of the gaussian noise on every pixel
+    double fps = 30;
+    int emptyframes = 60;   //frames of an empty board at the start, used to find the board
+    int settleframes = 400; //frames after the pieces are put on the board, and after the last move
+    int moveframes = 45;    //frames it takes a hand to make a move
+    int thinkframes = 360;  //frames between two moves
+    bool hands = true;      //draw the hands, without them the pieces teleport
+    unsigned int seed = 1;  //seed of the noise, the same seed gives the same video
+};
+
+class SynthBoard
+{
+public:
+    SynthBoard(synthConfig config, vector<string> moves);
+
+    bool nextFrame(Mat& frame); //false once the game is over
+    int frameIndex() const { return frame; }
+    int totalFrames() const { return total; }
+    double fps() const { return config.fps; }
+    vector<string> playedMoves() const { return san; }     //the moves of the pgn that were legal, in SAN
+    vector<int> moveFrames() const { return handleft; }    //frame on which the hand left the board for every move
+
+private:
+    void render(Mat& img, int hidden, int carried, Point hand, bool whitehand);
+    void drawPiece(Mat& img, int nr, Point centre);
+    void drawHand(Mat& img, Point tip, bool fromtop);
+    Point squareCentre(int square) const;
+
+    synthConfig config;
+    Board board;                //the position as it's shown right now
+    vector<chessMove> moves;
+    vector<string> san;
+    vector<int> movestart;      //frame on which the hand starts moving for every move
+    vector<int> handleft;
+    int applied;                //amount of moves that are already on the board
+    int frame;
+    int total;
+    Size topsize;               //size of the board seen from straight above
+    Mat perspective;
+    RNG rng;
+};
+
+#endif
@@ -0,0 +1,81 @@
+/* Tool that turns a pgn into a synthetic video of the game, for testing the pipeline without filming real games
+ * next to the video it writes the ground truth: for every move the frame on which the hand left the board
+ */
+
+#include "synthboard.h"
+
+int main(int argc, const char **argv)
+{
+    CommandLineParser parser(argc, argv,
+    "{ help h usage ?  || show this message }"
+    "{ pgn p           || path to the pgn of the game }"
+    "{ output o        |synthetic.avi| path to the video that gets written }"
+    "{ truth t         || path to the file where the ground truth is written to; default is the video with .txt }"
+    "{ width           |640| width of the frames }"
+    "{ height          |480| height of the frames }"
+    "{ fps             |30| frames per second }"
+    "{ tilt            |0.15| perspective, 0 is straight from above }"
+    "{ gain            |1.0| lighting gain }"
+    "{ offset          |0| lighting offset }"
+    "{ drift           |0| amplitude of a slow change in the lighting (eg 0.1) }"
+    "{ noise           |2.0| standard deviation of the noise }"
+    "{ think           |360| frames between two moves }"
+    "{ nohands         || don't draw the hands }"
+    "{ seed            |1| seed of the noise }"
+    );
+
+    if (parser.has("help") || !parser.has("pgn"))
+    {
+        parser.printMessage();
+        return 0;
+    }
+
+    synthConfig config;
+    config.width = parser.get<int>("width");
+    config.height = parser.get<int>("height");
+    config.fps = parser.get<double>("fps");
+    config.tilt = parser.get<double>("tilt");
+    config.gain = parser.get<double>("gain");
+    config.offset = parser.get<double>("offset");
+    config.drift = parser.get<double>("drift");
+    config.noise = parser.get<double>("noise");
+    config.thinkframes = parser.get<int>("think");
+    config.hands = !parser.has("nohands");
+    config.seed = parser.get<int>("seed");
+
+    string output_location(parser.get<string>("output"));
+    string truth_location(parser.get<string>("truth"));
+    if (truth_location.empty())
+    {
+        truth_location = output_location.substr(0, output_location.find_last_of('.')) + ".txt";
+    }
+
+    SynthBoard synth(config, readPgnMoves(parser.get<string>("pgn")));
+
+    VideoWriter writer;
+    writer.open(output_location, VideoWriter::fourcc('M','J','P','G'), config.fps, Size(config.width, config.height));
+    if (!writer.isOpened())
+    {
+        cerr << "Cannot open " << output_location << " for writing!" << endl;
+        return -1;
+    }
+
+    Mat frame;
+    while (synth.nextFrame(frame))
+    {
+        writer.write(frame);
+    }
+    writer.release();
+
+    ofstream truth(truth_location);
+    truth << "# ply | frame on which the hand left the board | move" << endl;
+    vector<string> moves = synth.playedMoves();
+    vector<int> frames = synth.moveFrames();
+    for (int i = 0; i < moves.size(); i++)
+    {
+        truth << i + 1 << " " << frames[i] << " " << moves[i] << endl;
+    }
+
+    cout << "Wrote " << synth.totalFrames() << " frames and " << moves.size() << " moves to " << output_location << endl;
+    return 0;
+}
@@ -0,0 +1,119 @@
+/* Background subtraction in tiles
+ */
+
+#include "tiledbackground.h"
+
+TiledBackground::TiledBackground(int tilesperside) : side(tilesperside)
+{
+    models.resize(side*side);
+    rects.resize(side*side);
+    rates.assign(side*side, -1);
+    for (int i = 0; i < models.size(); i++)
+    {
+        models[i] = createModel();
+    }
+}
+
+Ptr<BackgroundSubtractorMOG2> TiledBackground::createModel() const
+{
+    Ptr<BackgroundSubtractorMOG2> model = createBackgroundSubtractorMOG2();
+    model->setBackgroundRatio(0.5); //TODO: explain why this is needed
+    return model;
+}
+
+/* Function that splits a frame of a certain size in tiles, the last row and column get what's left
+ *  input: the size of the frames
+ *  output: void
+ */
+void TiledBackground::layout(Size framesize)
+{
+    size = framesize;
+    int w = framesize.width/side;
+    int h = framesize.height/side;
+    for (int row = 0; row < side; row++)
+    {
+        for (int col = 0; col < side; col++)
+        {
+            int x = col*w;
+            int y = row*h;
+            rects[row*side + col] = Rect(x, y, col == side - 1 ? framesize.width - x : w, row == side - 1 ? framesize.height - y : h);
+        }
+    }
+    //a model that learned another size is worthless
+    for (int i = 0; i < models.size(); i++)
+    {
+        models[i] = createModel();
+    }
+}
+
+void TiledBackground::apply(const Mat& frame, Mat& fgmask)
+{
+    if (frame.size() != size)
+    {
+        layout(frame.size());
+    }
+    fgmask.create(frame.size(), CV_8UC1);
+
+    //every tile only touches its own part of the mask, so they can run side by side
+    parallel_for_(Range(0, (int)models.size()), [&](const Range& range)
+    {
+        for (int i = range.start; i < range.end; i++)
+        {
+            Mat tilemask;
+            models[i]->apply(frame(rects[i]), tilemask, rates[i]);
+            tilemask.copyTo(fgmask(rects[i]));
+        }
+    });
+}
+
+void TiledBackground::getBackgroundImage(Mat& bg) const
+{
+    if (size.area() == 0)
+    {
+        bg.release();
+        return;
+    }
+    Mat tilebg;
+    for (int i = 0; i < models.size(); i++)
+    {
+        models[i]->getBackgroundImage(tilebg);
+        if (tilebg.empty())
+        {
+            continue;
+        }
+        if (bg.size() != size || bg.type() != tilebg.type())
+        {
+            bg.create(size, tilebg.type());
+            bg.setTo(Scalar::all(0));
+        }
+        tilebg.copyTo(bg(rects[i]));
+    }
+}
+
+int TiledBackground::tileAt(Point p) const
+{
+    for (int i = 0; i < rects.size(); i++)
+    {
+        if (rects[i].contains(p))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void TiledBackground::resetTile(int tile)
+{
+    models[tile] = createModel();
+}
+
+void TiledBackground::resetTiles(Rect area)
+{
+    for (int i = 0; i < rects.size(); i++)
+    {
+        if ((rects[i] & area).area() > 0)
+        {
+            resetTile(i);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+/* Background subtraction in tiles
+ * the frame is split in a grid of tiles that each have their own MOG2 model, so they can be updated in parallel,
+ * and a tile can get its own learning rate, be frozen or start over without touching the rest of the board
+ */
+#ifndef TILEDBACKGROUND_H
+#define TILEDBACKGROUND_H
+
+#include "chessdetection.h"
+
+#define BG_TILES 4 //the frame is split in BG_TILES x BG_TILES tiles
+
+class TiledBackground
+{
+public:
+    TiledBackground(int tilesperside = BG_TILES);
+
+    /* Function that runs a frame through the model of every tile, the tiles in parallel
+     *  input: the frame, and the mask to write the foreground in (it gets the size of the frame)
+     *  output: void
+     */
+    void apply(const Mat& frame, Mat& fgmask);
+    void getBackgroundImage(Mat& bg) const;
+
+    int tiles() const { return models.size(); }
+    int tileAt(Point p) const; //the tile a point of the frame is in, -1 if it's outside the frame
+    Rect tileRect(int tile) const { return rects[tile]; }
+
+    void setLearningRate(int tile, double rate) { rates[tile] = rate; } //-1 lets MOG2 pick it, 0 freezes the tile
+    double learningRate(int tile) const { return rates[tile]; }
+    void freeze(int tile) { rates[tile] = 0; }
+    void resetTile(int tile); //forget everything the tile learned, it starts over on the next frame
+    void resetTiles(Rect area); //every tile that overlaps the area
+
+private:
+    Ptr<BackgroundSubtractorMOG2> createModel() const;
+    void layout(Size framesize);
+
+    int side;
+    Size size;          //size of the frames the tiles were laid out for
+    vector<Ptr<BackgroundSubtractorMOG2>> models;
+    vector<Rect> rects;
+    vector<double> rates;
+};
+
+#endif